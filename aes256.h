@@ -115,7 +115,23 @@ class aes256
     m_state[2][0] = m_state[2][1] = m_state[2][2] = m_state[2][3] = 0;
     m_state[3][0] = m_state[3][1] = m_state[3][2] = m_state[3][3] = 0;
     memset(m_round_key, 0, 4 * 60 * sizeof(m_round_key[0][0]));
-    key_expansion();
+    key_expansion(m_key.data(), m_key.size());
+  }
+
+  aes256(const uint8_t *key)
+  {
+    /*
+    ** A raw 256-bit key. Nothing is allocated.
+    */
+
+    m_Nb = 4;
+    m_Nk = 8;
+    m_Nr = 14;
+    m_block_length = 16; // Or, 128 bits.
+    m_key_length = 32; // Or, 256 bits.
+    memset(m_round_key, 0, 4 * 60 * sizeof(m_round_key[0][0]));
+    memset(m_state, 0, 4 * 4 * sizeof(m_state[0][0]));
+    key_expansion(key, key ? 32 : 0);
   }
 
   ~aes256()
@@ -221,6 +237,12 @@ class aes256
       return b;
 
     b.resize(16);
+    encrypt_block(block.data(), b.data());
+    return b;
+  }
+
+  void encrypt_block(const uint8_t *block, uint8_t *b)
+  {
     m_state[0][0] = block[0 + 4 * 0];
     m_state[0][1] = block[0 + 4 * 1];
     m_state[0][2] = block[0 + 4 * 2];
@@ -266,7 +288,6 @@ class aes256
     b[3 + 4 * 1] = m_state[3][1];
     b[3 + 4 * 2] = m_state[3][2];
     b[3 + 4 * 3] = m_state[3][3];
-    return b;
   }
 
  private:
@@ -424,7 +445,7 @@ class aes256
     m_state[3][3] = s_inv_sbox[static_cast<size_t> (m_state[3][3])];
   }
 
-  void key_expansion(void)
+  void key_expansion(const uint8_t *key, const size_t size)
   {
     size_t i = 0;
 
@@ -432,17 +453,17 @@ class aes256
       {
 	auto const product = 4 * i;
 
-	if(m_key.size() > product)
-	  m_round_key[i][0] = m_key[product + 0];
+	if(size > product)
+	  m_round_key[i][0] = key[product + 0];
 
-	if(m_key.size() > product + 1)
-	  m_round_key[i][1] = m_key[product + 1];
+	if(size > product + 1)
+	  m_round_key[i][1] = key[product + 1];
 
-	if(m_key.size() > product + 2)
-	  m_round_key[i][2] = m_key[product + 2];
+	if(size > product + 2)
+	  m_round_key[i][2] = key[product + 2];
 
-	if(m_key.size() > product + 3)
-	  m_round_key[i][3] = m_key[product + 3];
+	if(size > product + 3)
+	  m_round_key[i][3] = key[product + 3];
 
 	i += 1;
       }
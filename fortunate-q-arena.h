@@ -0,0 +1,464 @@
+/*
+** Copyright (c) 2023, Alexis Megas.
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from FortunateQ without specific prior written permission.
+**
+** FORTUNATEQ IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** FORTUNATEQ, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _fortunate_q_arena_h_
+#define _fortunate_q_arena_h_
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__APPLE__) || defined(__unix__)
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#ifndef FORTUNATE_Q_ARENA_SIZE
+#define FORTUNATE_Q_ARENA_SIZE 65536
+#endif
+
+/*
+** Memory for keys, pools, and output buffers. A fixed, locked region
+** surrounded by guard pages is divided into slabs of 16 through 4096
+** bytes. Larger requests, and requests which the region cannot satisfy,
+** receive their own locked mapping with guard pages. Memory is erased
+** as it is released. Locks are not inherited by a child process, so
+** the mappings are locked again after fork(). Other platforms fall back
+** to the heap.
+*/
+
+class fortunate_q_arena
+{
+ public:
+  static fortunate_q_arena &instance(void)
+  {
+    static fortunate_q_arena arena(FORTUNATE_Q_ARENA_SIZE);
+#if defined(__APPLE__) || defined(__unix__)
+    static auto const registered =
+      pthread_atfork(&fork_prepare, &fork_parent, &fork_child) == 0;
+
+    static_cast<void> (registered);
+#endif
+    return arena;
+  }
+
+  static void zeroize(void *data, const size_t size)
+  {
+    auto p = static_cast<volatile uint8_t *> (data);
+
+    for(size_t i = 0; i < size && p; i++)
+      p[i] = 0;
+  }
+
+  bool is_locked(void) const
+  {
+    /*
+    ** Whether the region is locked. In a child process, also whether
+    ** every mapping was locked again.
+    */
+
+    return m_locked;
+  }
+
+  void *allocate(const size_t size)
+  {
+    /*
+    ** The memory is erased. Blocks are aligned to their size class,
+    ** mappings to a page.
+    */
+
+    if(size == 0)
+      return nullptr;
+
+    auto const c = size_class(size);
+
+    if(c < SIZE_CLASSES)
+      {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if(m_free[c] || carve(c))
+	  {
+	    auto block = m_free[c];
+
+	    m_free[c] = block->m_next;
+	    block->m_next = nullptr;
+	    return block;
+	  }
+      }
+
+    return map(size, nullptr, -1);
+  }
+
+  void *allocate_node(const size_t size, const int node)
+  {
+    /*
+    ** A separate mapping whose pages prefer NUMA node node. Release it
+    ** with release().
+    */
+
+    return size == 0 ? nullptr : map(size, nullptr, node);
+  }
+
+  void release(void *data, const size_t size)
+  {
+    if(!data || size == 0)
+      return;
+
+    auto const c = size_class(size);
+
+    if(c < SIZE_CLASSES && contains(data))
+      {
+	zeroize(data, MINIMUM_CLASS << c);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto block = static_cast<free_block *> (data);
+
+	block->m_next = m_free[c];
+	m_free[c] = block;
+      }
+    else
+      unmap(data, size);
+  }
+
+ private:
+  static constexpr size_t MINIMUM_CLASS = 16;
+  static constexpr size_t SIZE_CLASSES = 9; // 16 through 4096 bytes.
+
+  struct free_block
+  {
+    free_block *m_next;
+  };
+
+  struct mapping
+  {
+    size_t m_length;
+    uint8_t *m_data;
+  };
+
+  bool m_locked;
+  free_block *m_free[SIZE_CLASSES];
+  std::vector<mapping> m_mappings;
+  size_t m_capacity;
+  size_t m_page_size;
+  size_t m_used;
+  std::mutex m_mutex;
+  uint8_t *m_region;
+
+  fortunate_q_arena(const size_t capacity)
+  {
+    m_locked = false;
+    m_page_size = page_size();
+    m_capacity = round_up(capacity);
+    m_region = static_cast<uint8_t *> (map(m_capacity, &m_locked, -1));
+    m_used = 0;
+
+    for(size_t i = 0; i < SIZE_CLASSES; i++)
+      m_free[i] = nullptr;
+
+    if(!m_region)
+      m_capacity = 0;
+  }
+
+  ~fortunate_q_arena()
+  {
+    unmap(m_region, m_capacity);
+  }
+
+  fortunate_q_arena(const fortunate_q_arena &) = delete;
+  fortunate_q_arena &operator=(const fortunate_q_arena &) = delete;
+
+#if defined(__APPLE__) || defined(__unix__)
+  static void fork_child(void)
+  {
+    /*
+    ** The child is single-threaded and the mutex is held.
+    */
+
+    auto &arena(instance());
+    auto locked = arena.m_region != nullptr;
+
+    for(auto const &m : arena.m_mappings)
+      if(mlock(m.m_data, m.m_length) != 0)
+	locked = false;
+
+    arena.m_locked = locked;
+    arena.m_mutex.unlock();
+  }
+
+  static void fork_parent(void)
+  {
+    instance().m_mutex.unlock();
+  }
+
+  static void fork_prepare(void)
+  {
+    instance().m_mutex.lock();
+  }
+#endif
+
+  static size_t page_size(void)
+  {
+#if defined(_WIN32)
+    SYSTEM_INFO information;
+
+    GetSystemInfo(&information);
+    return static_cast<size_t> (information.dwPageSize);
+#elif defined(__APPLE__) || defined(__unix__)
+    auto const size = sysconf(_SC_PAGESIZE);
+
+    return size > 0 ? static_cast<size_t> (size) : 4096;
+#else
+    return 4096;
+#endif
+  }
+
+  static size_t size_class(const size_t size)
+  {
+    size_t c = 0;
+
+    while(c < SIZE_CLASSES && (MINIMUM_CLASS << c) < size)
+      c += 1;
+
+    return c;
+  }
+
+  bool carve(const size_t c)
+  {
+    /*
+    ** Divides the next page of the region into blocks of class c.
+    */
+
+    auto const block_size = MINIMUM_CLASS << c;
+
+    if(block_size > m_page_size || m_capacity - m_used < m_page_size)
+      return false;
+
+    auto const page = m_region + m_used;
+
+    m_used += m_page_size;
+
+    for(size_t i = m_page_size / block_size; i > 0; i--)
+      {
+	auto block = reinterpret_cast<free_block *>
+	  (page + (i - 1) * block_size);
+
+	block->m_next = m_free[c];
+	m_free[c] = block;
+      }
+
+    return true;
+  }
+
+  bool contains(const void *data) const
+  {
+    auto const p = reinterpret_cast<uintptr_t> (data);
+    auto const r = reinterpret_cast<uintptr_t> (m_region);
+
+    return m_region && p >= r && p < r + m_capacity;
+  }
+
+  size_t round_up(const size_t size) const
+  {
+    return (size + m_page_size - 1) / m_page_size * m_page_size;
+  }
+
+  void *map(const size_t size, bool *locked, const int node)
+  {
+    /*
+    ** A guard page precedes and follows the locked pages. The NUMA
+    ** policy is applied before mlock() faults the pages in.
+    */
+
+    auto const length = round_up(size);
+
+    if(locked)
+      *locked = false;
+
+#if defined(_WIN32)
+    auto base = static_cast<uint8_t *>
+      (node >= 0 ?
+       VirtualAllocExNuma(GetCurrentProcess(),
+			  nullptr,
+			  length + 2 * m_page_size,
+			  MEM_COMMIT | MEM_RESERVE,
+			  PAGE_READWRITE,
+			  static_cast<DWORD> (node)) :
+       VirtualAlloc(nullptr,
+		    length + 2 * m_page_size,
+		    MEM_COMMIT | MEM_RESERVE,
+		    PAGE_READWRITE));
+    DWORD protection = 0;
+
+    if(!base)
+      return nullptr;
+
+    VirtualProtect(base, m_page_size, PAGE_NOACCESS, &protection);
+    VirtualProtect
+      (base + m_page_size + length, m_page_size, PAGE_NOACCESS, &protection);
+
+    if(VirtualLock(base + m_page_size, length) && locked)
+      *locked = true;
+
+    return base + m_page_size;
+#elif defined(__APPLE__) || defined(__unix__)
+    auto base = static_cast<uint8_t *>
+      (mmap(nullptr,
+	    length + 2 * m_page_size,
+	    PROT_READ | PROT_WRITE,
+	    MAP_ANON | MAP_PRIVATE,
+	    -1,
+	    0));
+
+    if(base == MAP_FAILED)
+      return nullptr;
+
+    mprotect(base, m_page_size, PROT_NONE);
+    mprotect(base + m_page_size + length, m_page_size, PROT_NONE);
+
+#if defined(SYS_mbind)
+    if(node >= 0 && node < static_cast<int> (8 * sizeof(unsigned long)))
+      {
+	auto const mask = 1UL << node;
+
+	syscall(SYS_mbind,
+		base + m_page_size,
+		length,
+		1, // MPOL_PREFERRED
+		&mask,
+		8 * sizeof(mask),
+		0);
+      }
+#else
+    static_cast<void> (node);
+#endif
+
+    if(mlock(base + m_page_size, length) == 0 && locked)
+      *locked = true;
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+
+      m_mappings.push_back(mapping{length, base + m_page_size});
+    }
+
+#ifdef MADV_DONTDUMP
+    madvise(base + m_page_size, length, MADV_DONTDUMP);
+#endif
+    return base + m_page_size;
+#else
+    static_cast<void> (node);
+    return calloc(1, length);
+#endif
+  }
+
+  void unmap(void *data, const size_t size)
+  {
+    if(!data)
+      return;
+
+    auto const length = round_up(size);
+
+    zeroize(data, length);
+#if defined(_WIN32)
+    VirtualUnlock(data, length);
+    VirtualFree(static_cast<uint8_t *> (data) - m_page_size, 0, MEM_RELEASE);
+#elif defined(__APPLE__) || defined(__unix__)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+
+      for(size_t i = 0; i < m_mappings.size(); i++)
+	if(m_mappings[i].m_data == data)
+	  {
+	    m_mappings[i] = m_mappings.back();
+	    m_mappings.pop_back();
+	    break;
+	  }
+    }
+
+    munlock(data, length);
+    munmap(static_cast<uint8_t *> (data) - m_page_size,
+	   length + 2 * m_page_size);
+#else
+    free(data);
+#endif
+  }
+};
+
+/*
+** An object of type T which lives in the arena.
+*/
+
+template<typename T>
+class fortunate_q_secure
+{
+ public:
+  static_assert(alignof(T) <= 16, "T requires a stricter alignment.");
+
+  fortunate_q_secure(void)
+  {
+    auto data = fortunate_q_arena::instance().allocate(sizeof(T));
+
+    if(!data)
+      throw std::bad_alloc();
+
+    m_data = new (data) T();
+  }
+
+  ~fortunate_q_secure()
+  {
+    m_data->~T();
+    fortunate_q_arena::instance().release(m_data, sizeof(T));
+  }
+
+  fortunate_q_secure(const fortunate_q_secure &) = delete;
+  fortunate_q_secure &operator=(const fortunate_q_secure &) = delete;
+
+  T &operator*(void) const
+  {
+    return *m_data;
+  }
+
+  T *operator->(void) const
+  {
+    return m_data;
+  }
+
+ private:
+  T *m_data;
+};
+
+#endif
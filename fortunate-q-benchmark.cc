@@ -0,0 +1,377 @@
+/*
+** Copyright (c) 2023, Alexis Megas.
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from FortunateQ without specific prior written permission.
+**
+** FORTUNATEQ IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** FORTUNATEQ, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "fortunate-q.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+/*
+** Results are written as JSON, one object per measurement.
+*/
+
+struct fortunate_q_forced_reseed_policy: public fortunate_q_reseed_policy
+{
+  /*
+  ** Reseeds before every request.
+  */
+
+  using fortunate_q_reseed_policy::fortunate_q_reseed_policy;
+
+  bool should_reseed(const std::chrono::steady_clock::time_point &now,
+		     const std::chrono::steady_clock::time_point &last,
+		     const uint64_t pool_0_size,
+		     const uint64_t new_bytes) const
+  {
+    Q_UNUSED(now);
+    Q_UNUSED(last);
+    Q_UNUSED(pool_0_size);
+    Q_UNUSED(new_bytes);
+    return true;
+  }
+};
+
+class fortunate_q_benchmark
+{
+ public:
+  fortunate_q_benchmark(const qint64 duration)
+  {
+    m_duration = qMax(static_cast<qint64> (1), duration);
+  }
+
+  QJsonArray results(void) const
+  {
+    return m_results;
+  }
+
+  void batch(void)
+  {
+    /*
+    ** 256 requests of 32 bytes each, as a session-key service might
+    ** collect them.
+    */
+
+    QByteArray data(256 * 32, 0);
+    QElapsedTimer timer;
+    QVector<char *> outputs;
+    QVector<int> sizes(256, 32);
+    fortunate_q f(nullptr);
+    qint64 requests = 0;
+
+    for(int i = 0; i < sizes.size(); i++)
+      outputs << data.data() + 32 * i;
+
+    timer.start();
+
+    do
+      {
+	if(!f.random_data_batch(outputs.constData(),
+				sizes.constData(),
+				sizes.size()))
+	  return;
+
+	requests += sizes.size();
+      }
+    while(timer.elapsed() < m_duration);
+
+    record("random_data_batch",
+	   32,
+	   static_cast<double> (requests) * 1000000000.0 / timer.nsecsElapsed(),
+	   "requests/s");
+  }
+
+  void cipher(void)
+  {
+    uint8_t block[16] = {0};
+    uint8_t key[32] = {0};
+    aes256 aes(key);
+    QElapsedTimer timer;
+    qint64 blocks = 0;
+
+    timer.start();
+
+    do
+      {
+	for(int i = 0; i < 1024; i++)
+	  aes.encrypt_block(block, block);
+
+	blocks += 1024;
+      }
+    while(timer.elapsed() < m_duration);
+
+    record("aes256_encrypt_block",
+	   16,
+	   static_cast<double> (blocks) * 1000000000.0 / timer.nsecsElapsed(),
+	   "blocks/s");
+  }
+
+  void generator(void)
+  {
+    fortunate_q f(nullptr);
+
+    for(int size = 16; size <= 1048576; size *= 4)
+      {
+	QByteArray data(size, 0);
+	QElapsedTimer timer;
+	qint64 bytes = 0;
+
+	timer.start();
+
+	do
+	  {
+	    if(!f.random_data(data.data(), size))
+	      return;
+
+	    bytes += size;
+	  }
+	while(timer.elapsed() < m_duration);
+
+	record("random_data",
+	       size,
+	       static_cast<double> (bytes) * 1000000000.0 /
+	       timer.nsecsElapsed(),
+	       "bytes/s");
+      }
+  }
+
+  void ingestion(void)
+  {
+    /*
+    ** A loopback peer writes random data as quickly as it can. The
+    ** measurement ends once every byte has reached the pools, as the
+    ** statistics report it. The rate includes the cost of the writer
+    ** and of the health tests.
+    */
+
+    QTcpServer server;
+
+    if(!server.listen(QHostAddress::LocalHost))
+      return;
+
+    QByteArray chunk(65536, 0);
+    QElapsedTimer timer;
+    QEventLoop loop;
+    auto const total = static_cast<qint64> (64) * 1048576;
+    fortunate_q f(nullptr);
+    qint64 elapsed = 0;
+    qint64 events = 0;
+
+    QRandomGenerator::global()->fillRange
+      (reinterpret_cast<quint32 *> (chunk.data()),
+       chunk.size() / static_cast<int> (sizeof(quint32)));
+
+    QObject::connect(&f,
+		     &fortunate_q::pool_filled,
+		     [&events](const int index, const int source)
+		     {
+		       Q_UNUSED(index);
+		       Q_UNUSED(source);
+		       events += 1;
+		     });
+    QObject::connect(&f,
+		     &fortunate_q::statistics_updated,
+		     [&](const fortunate_q_statistics &statistics)
+		     {
+		       quint64 bytes = 0;
+
+		       for(auto const i : statistics.m_source_bytes)
+			 bytes += i;
+
+		       if(bytes >= static_cast<quint64> (total) &&
+			  elapsed == 0 &&
+			  timer.isValid())
+			 {
+			   elapsed = timer.nsecsElapsed();
+			   loop.quit();
+			 }
+		     });
+    QObject::connect
+      (&server,
+       &QTcpServer::newConnection,
+       [&](void)
+       {
+	 auto socket = server.nextPendingConnection();
+
+	 if(!socket)
+	   return;
+
+	 server.close();
+	 timer.start();
+
+	 for(qint64 i = 0; i < total; i += chunk.size())
+	   {
+	     socket->write(chunk);
+
+	     while(socket->bytesToWrite() > 4 * chunk.size())
+	       {
+		 socket->waitForBytesWritten(10);
+		 QCoreApplication::processEvents();
+	       }
+	   }
+
+	 socket->disconnectFromHost();
+       });
+    QTimer::singleShot(60000, &loop, &QEventLoop::quit);
+    f.set_tcp_peer(server.serverAddress().toString(),
+		   false,
+		   server.serverPort());
+    f.set_statistics_interval(1);
+    loop.exec();
+
+    if(elapsed > 0)
+      {
+	record("process_device",
+	       total,
+	       static_cast<double> (total) * 1000000000.0 / elapsed,
+	       "bytes/s");
+	record("process_device_events",
+	       total,
+	       static_cast<double> (events) * 1000000000.0 / elapsed,
+	       "events/s");
+      }
+  }
+
+  void reseed(void)
+  {
+    /*
+    ** Every pool receives size bytes and then every pool takes part in
+    ** a reseed. The pools are hashed as the events arrive, so the cost
+    ** of the events is included.
+    */
+
+    fortunate_q_basic_core<fortunate_q_core::POOLS,
+			   fortunate_q_core::MIN_POOL_SIZE,
+			   fortunate_q_core::RESEED_INTERVAL,
+			   fortunate_q_forced_reseed_policy> core;
+
+    for(int size = 0; size <= 1048576; size = size == 0 ? 64 : size * 4)
+      {
+	QByteArray event(32, 0);
+	uint8_t data[16];
+	qint64 elapsed = 0;
+	qint64 reseeds = 0;
+
+	do
+	  {
+	    QElapsedTimer timer;
+
+	    timer.start();
+
+	    for(size_t i = 0; i < fortunate_q_core::POOLS; i++)
+	      for(int j = 0; j < size; j += event.size())
+		core.add_random_event
+		  (i,
+		   0,
+		   reinterpret_cast<const uint8_t *> (event.constData()),
+		   static_cast<size_t> (event.size()));
+
+	    core.set_reseed_count
+	      ((static_cast<quint64> (1) << (fortunate_q_core::POOLS - 1)) - 1);
+	    core.random_data(data, sizeof(data));
+	    elapsed += timer.nsecsElapsed();
+	    reseeds += 1;
+	  }
+	while(elapsed < m_duration * 1000000);
+
+	record("reseed",
+	       size,
+	       static_cast<double> (elapsed) / reseeds,
+	       "ns");
+      }
+  }
+
+ private:
+  QJsonArray m_results;
+  qint64 m_duration;
+
+  void record(const QString &name,
+	      const qint64 size,
+	      const double value,
+	      const QString &unit)
+  {
+    QJsonObject object;
+
+    object["name"] = name;
+    object["size"] = size;
+    object["unit"] = unit;
+    object["value"] = value;
+    m_results.append(object);
+  }
+};
+
+int main(int argc, char *argv[])
+{
+  QCoreApplication application(argc, argv);
+  QCommandLineParser parser;
+
+  parser.addHelpOption();
+  parser.addOption
+    (QCommandLineOption("duration",
+			"Milliseconds per measurement.",
+			"msecs",
+			"1000"));
+  parser.addOption
+    (QCommandLineOption("out", "Output file or - for stdout.", "file", "-"));
+  parser.setApplicationDescription
+    ("Measures the cipher, the generator, batches, reseeding and "
+     "ingestion.");
+  parser.process(application);
+
+  QJsonObject object;
+  fortunate_q_benchmark benchmark(parser.value("duration").toLongLong());
+
+  benchmark.cipher();
+  benchmark.generator();
+  benchmark.batch();
+  benchmark.reseed();
+  benchmark.ingestion();
+  object["qt"] = QString(qVersion());
+  object["results"] = benchmark.results();
+  object["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+
+  QFile file;
+
+  if(parser.value("out") == "-")
+    file.open(stdout, QIODevice::WriteOnly);
+  else
+    {
+      file.setFileName(parser.value("out"));
+      file.open(QIODevice::Truncate | QIODevice::WriteOnly);
+    }
+
+  if(file.write(QJsonDocument(object).toJson()) < 0)
+    return EXIT_FAILURE;
+
+  return EXIT_SUCCESS;
+}
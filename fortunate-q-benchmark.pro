@@ -0,0 +1,11 @@
+include(fortunate-q.pri)
+
+QMAKE_CLEAN	+= fortunate-q-benchmark
+
+HEADERS	       += fortunate-q.h
+MOC_DIR         = Temporary/benchmark/moc
+OBJECTS_DIR     = Temporary/benchmark/obj
+PROJECTNAME     = fortunate-q-benchmark
+RCC_DIR         = Temporary/benchmark/rcc
+SOURCES	       += fortunate-q-benchmark.cc
+TARGET		= fortunate-q-benchmark
@@ -0,0 +1,225 @@
+/*
+** Copyright (c) 2023, Alexis Megas.
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from FortunateQ without specific prior written permission.
+**
+** FORTUNATEQ IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** FORTUNATEQ, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "fortunate-q.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+
+/*
+** Examples:
+** fortunate-q-cli --bytes 1073741824 --out random.bin
+** fortunate-q-cli --file-source /dev/hwrng | dd of=/dev/sdx bs=1M
+** fortunate-q-cli --tcp-source 192.168.178.85:5000 --send-byte 0 | tester
+*/
+
+int main(int argc, char *argv[])
+{
+#ifdef Q_OS_UNIX
+  std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+  QCoreApplication application(argc, argv);
+  QCommandLineParser parser;
+
+  parser.addHelpOption();
+  parser.addOption
+    (QCommandLineOption("block-size",
+			"Bytes per write, 16 to 1048576.",
+			"size",
+			"1048576"));
+  parser.addOption
+    (QCommandLineOption("bytes",
+			"Bytes to write. Zero writes until interrupted.",
+			"n",
+			"0"));
+  parser.addOption
+    (QCommandLineOption("file-source", "File entropy source.", "file"));
+  parser.addOption
+    (QCommandLineOption("out", "Output file or - for stdout.", "file", "-"));
+  parser.addOption
+    (QCommandLineOption("seed-file", "Fortuna seed file.", "file"));
+  parser.addOption
+    (QCommandLineOption("send-byte",
+			"Byte sent every 5 milliseconds to the TCP source.",
+			"byte"));
+  parser.addOption
+    (QCommandLineOption("tcp-source", "TCP entropy source.", "host:port"));
+  parser.addOption(QCommandLineOption("tls", "Use TLS with the TCP source."));
+  parser.setApplicationDescription
+    ("Writes Fortuna output to a file or to stdout.");
+  parser.process(application);
+
+  auto ok = false;
+  auto const block_size = parser.value("block-size").toInt(&ok);
+
+  if(!ok || block_size < 16 || block_size > 1048576)
+    {
+      qCritical() << "Invalid block size"
+		  << parser.value("block-size")
+		  << ".";
+      return EXIT_FAILURE;
+    }
+
+  auto remaining = parser.value("bytes").toLongLong(&ok);
+
+  if(!ok || remaining < 0)
+    {
+      qCritical() << "Invalid byte count" << parser.value("bytes") << ".";
+      return EXIT_FAILURE;
+    }
+
+  auto const unlimited = remaining == 0;
+  fortunate_q f(nullptr);
+
+  if(parser.isSet("file-source"))
+    f.set_file_peer(parser.value("file-source"));
+#ifndef Q_OS_MACOS
+  else if(!parser.isSet("tcp-source"))
+    f.set_file_peer("/dev/urandom");
+#endif
+
+  if(parser.isSet("seed-file"))
+    f.set_seed_file(parser.value("seed-file"), 600000);
+
+  if(parser.isSet("send-byte"))
+    f.set_send_byte
+      (static_cast<char> (parser.value("send-byte").toInt()), 5);
+
+  if(parser.isSet("tcp-source"))
+    {
+      auto const list(parser.value("tcp-source").split(':'));
+
+      f.set_tcp_peer(list.value(0),
+		     parser.isSet("tls"),
+		     static_cast<quint16> (list.value(1).toUInt()));
+    }
+
+  QFile file;
+
+  if(parser.value("out") == "-")
+    file.open(fileno(stdout), QIODevice::Unbuffered | QIODevice::WriteOnly);
+  else
+    {
+      file.setFileName(parser.value("out"));
+      file.open(QIODevice::Truncate |
+		QIODevice::Unbuffered |
+		QIODevice::WriteOnly);
+    }
+
+  if(!file.isOpen())
+    {
+      qCritical() << "Cannot open the output file.";
+      return EXIT_FAILURE;
+    }
+
+  /*
+  ** Page-aligned blocks from the locked arena are written directly with
+  ** write(). One block is written per event-loop iteration so that the
+  ** sources keep feeding the pools.
+  */
+
+  auto buffer = static_cast<char *>
+    (fortunate_q_arena::instance().allocate
+     (static_cast<size_t> (block_size)));
+  int rc = EXIT_SUCCESS;
+
+  if(!buffer)
+    return EXIT_FAILURE;
+
+  QTimer timer;
+
+  QObject::connect(&timer,
+		   &QTimer::timeout,
+		   [&](void)
+		   {
+		     /*
+		     ** Nothing is written until the sources or a seed
+		     ** file have seeded the generator.
+		     */
+
+		     if(!f.is_seeded())
+		       {
+			 timer.setInterval(10);
+			 return;
+		       }
+
+		     timer.setInterval(0);
+
+		     auto const n = unlimited ?
+		       block_size :
+		       static_cast<int>
+		       (qMin(remaining, static_cast<qint64> (block_size)));
+
+		     if(n <= 0)
+		       {
+			 application.quit();
+			 return;
+		       }
+
+		     if(!f.random_data(buffer, n))
+		       {
+			 qCritical() << "Cannot generate data.";
+			 rc = EXIT_FAILURE;
+			 application.quit();
+			 return;
+		       }
+
+		     errno = 0;
+
+		     if(file.write(buffer, n) != n)
+		       {
+			 /*
+			 ** A closed pipe is the usual way to stop an
+			 ** unlimited stream. Other errors, such as a full
+			 ** disk, are failures.
+			 */
+
+			 if(errno != EPIPE || !unlimited)
+			   {
+			     qCritical() << "Cannot write:"
+					 << file.errorString();
+			     rc = EXIT_FAILURE;
+			   }
+
+			 application.quit();
+			 return;
+		       }
+
+		     remaining -= n;
+		   });
+  timer.start(0);
+  application.exec();
+  file.close();
+  fortunate_q_arena::instance().release
+    (buffer, static_cast<size_t> (block_size));
+  return rc;
+}
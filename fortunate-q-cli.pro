@@ -0,0 +1,11 @@
+include(fortunate-q.pri)
+
+QMAKE_CLEAN	+= fortunate-q-cli
+
+HEADERS	       += fortunate-q.h
+MOC_DIR         = Temporary/cli/moc
+OBJECTS_DIR     = Temporary/cli/obj
+PROJECTNAME     = fortunate-q-cli
+RCC_DIR         = Temporary/cli/rcc
+SOURCES	       += fortunate-q-cli.cc
+TARGET		= fortunate-q-cli
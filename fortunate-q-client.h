@@ -0,0 +1,118 @@
+/*
+** Copyright (c) 2023, Alexis Megas.
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from FortunateQ without specific prior written permission.
+**
+** FORTUNATEQ IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** FORTUNATEQ, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _fortunate_q_client_h_
+#define _fortunate_q_client_h_
+
+#include <QLocalSocket>
+#include <QVector>
+#include <QtEndian>
+
+/*
+** A blocking client of fortunate_q_server. An event loop is not required.
+*/
+
+class fortunate_q_client
+{
+ public:
+  fortunate_q_client(void)
+  {
+  }
+
+  ~fortunate_q_client()
+  {
+    m_socket.abort();
+  }
+
+  QByteArray random_data(const int n, const int msecs = 5000)
+  {
+    auto const data(random_data(QVector<int> () << n, msecs));
+
+    return data.isEmpty() ? QByteArray() : data.at(0);
+  }
+
+  QVector<QByteArray> random_data(const QVector<int> &n, const int msecs)
+  {
+    /*
+    ** The requests are pipelined.
+    */
+
+    QByteArray request;
+    QVector<QByteArray> data;
+
+    for(int i = 0; i < n.size(); i++)
+      {
+	if(n.at(i) <= 0 || n.at(i) > 1048576)
+	  return QVector<QByteArray> ();
+
+	auto const size = qToBigEndian(static_cast<quint32> (n.at(i)));
+
+	request.append(reinterpret_cast<const char *> (&size), 4);
+      }
+
+    if(m_socket.state() != QLocalSocket::ConnectedState ||
+       m_socket.write(request) != request.size())
+      return data;
+
+    m_socket.flush();
+
+    for(int i = 0; i < n.size(); i++)
+      {
+	QByteArray bytes;
+
+	bytes.reserve(n.at(i));
+
+	while(bytes.size() < n.at(i))
+	  {
+	    if(m_socket.bytesAvailable() == 0 &&
+	       !m_socket.waitForReadyRead(msecs))
+	      {
+		m_socket.abort();
+		return QVector<QByteArray> ();
+	      }
+
+	    bytes.append(m_socket.read(n.at(i) - bytes.size()));
+	  }
+
+	data << bytes;
+      }
+
+    return data;
+  }
+
+  bool connect_to_server(const QString &name, const int msecs = 5000)
+  {
+    m_socket.abort();
+    m_socket.connectToServer(name.trimmed());
+    return m_socket.waitForConnected(msecs);
+  }
+
+ private:
+  QLocalSocket m_socket;
+};
+
+#endif
@@ -0,0 +1,599 @@
+/*
+** Copyright (c) 2023, Alexis Megas.
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from FortunateQ without specific prior written permission.
+**
+** FORTUNATEQ IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** FORTUNATEQ, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _fortunate_q_core_h_
+#define _fortunate_q_core_h_
+
+#include "aes256.h"
+#include "fortunate-q-arena.h"
+#include "sha256.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__APPLE__) || defined(__unix__)
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#if defined(__APPLE__) || defined(__linux__)
+#include <sys/random.h>
+#endif
+
+/*
+** The configuration of fortunate_q_core, and therefore of fortunate_q.
+** Other configurations may instantiate fortunate_q_basic_core directly.
+*/
+
+#ifndef FORTUNATE_Q_MIN_POOL_SIZE
+#define FORTUNATE_Q_MIN_POOL_SIZE 64
+#endif
+#ifndef FORTUNATE_Q_POOLS
+#define FORTUNATE_Q_POOLS 32
+#endif
+#ifndef FORTUNATE_Q_RESEED_INTERVAL
+#define FORTUNATE_Q_RESEED_INTERVAL 100
+#endif
+
+class counter_q
+{
+ public:
+  counter_q(void)
+  {
+    m_l = m_r = 0;
+  }
+
+  bool is_zero(void) const
+  {
+    return m_l == 0 && m_r == 0;
+  }
+
+  void increment(void)
+  {
+    m_r += 1;
+
+    if(m_r == 0)
+      m_l += 1;
+  }
+
+  void value(uint8_t *value) const
+  {
+    memcpy(value, &m_l, 8);
+    memcpy(value + 8, &m_r, 8);
+  }
+
+ private:
+  uint64_t m_l;
+  uint64_t m_r;
+};
+
+/*
+** Decides when a core reseeds. Intervals are in milliseconds. A reseed
+** requires that the minimum interval has passed and that a token is
+** available if reseeds per second are limited. It is then triggered by
+** pool 0 reaching its minimum size, by the new bytes in all of the pools
+** reaching a threshold, or by the maximum interval passing. A zero
+** disables a setting. The defaults are the original rule: pool 0 or the
+** reseed interval, whichever is first.
+*/
+
+class fortunate_q_reseed_policy
+{
+ public:
+  fortunate_q_reseed_policy(const size_t minimum_pool_size,
+			    const int64_t interval)
+  {
+    m_maximum_interval = interval;
+    m_minimum_interval = 0;
+    m_minimum_pool_size = minimum_pool_size;
+    m_new_bytes = 0;
+    set_reseeds_per_second(0.0);
+  }
+
+  bool should_reseed(const std::chrono::steady_clock::time_point &now,
+		     const std::chrono::steady_clock::time_point &last,
+		     const uint64_t pool_0_size,
+		     const uint64_t new_bytes)
+  {
+    auto const elapsed = std::chrono::duration_cast
+      <std::chrono::milliseconds> (now - last).count();
+
+    if(elapsed < m_minimum_interval)
+      return false;
+
+    if(m_reseeds_per_second > 0.0)
+      {
+	auto const burst = m_reseeds_per_second < 1.0 ?
+	  1.0 : m_reseeds_per_second;
+
+	m_tokens += m_reseeds_per_second *
+	  std::chrono::duration<double> (now - m_refilled).count();
+	m_tokens = m_tokens < burst ? m_tokens : burst;
+	m_refilled = now;
+
+	if(m_tokens < 1.0)
+	  return false;
+      }
+
+    return (m_minimum_pool_size > 0 && pool_0_size >= m_minimum_pool_size) ||
+      (m_new_bytes > 0 && new_bytes >= m_new_bytes) ||
+      (m_maximum_interval > 0 && elapsed > m_maximum_interval);
+  }
+
+  void reseeded(void)
+  {
+    if(m_reseeds_per_second > 0.0)
+      m_tokens -= 1.0;
+  }
+
+  void set_maximum_interval(const int64_t interval)
+  {
+    m_maximum_interval = interval > 0 ? interval : 0;
+  }
+
+  void set_minimum_interval(const int64_t interval)
+  {
+    m_minimum_interval = interval > 0 ? interval : 0;
+  }
+
+  void set_minimum_pool_size(const uint64_t size)
+  {
+    m_minimum_pool_size = size;
+  }
+
+  void set_new_bytes(const uint64_t bytes)
+  {
+    m_new_bytes = bytes;
+  }
+
+  void set_reseeds_per_second(const double rate)
+  {
+    m_refilled = std::chrono::steady_clock::now();
+    m_reseeds_per_second = rate > 0.0 ? rate : 0.0;
+    m_tokens = m_reseeds_per_second < 1.0 ? 1.0 : m_reseeds_per_second;
+  }
+
+ private:
+  std::chrono::steady_clock::time_point m_refilled;
+  double m_reseeds_per_second;
+  double m_tokens;
+  int64_t m_maximum_interval;
+  int64_t m_minimum_interval;
+  uint64_t m_minimum_pool_size;
+  uint64_t m_new_bytes;
+};
+
+/*
+** Fortuna without Qt. An instance is not thread-safe. The Qt adapter,
+** fortunate_q, adds the sources, the signals, and the timers. The
+** reseed interval is in milliseconds. The policy is constructed from
+** MinPoolSize and ReseedInterval and may be changed at run time.
+*/
+
+template<size_t Pools,
+	 size_t MinPoolSize,
+	 int64_t ReseedInterval,
+	 typename ReseedPolicy = fortunate_q_reseed_policy>
+class fortunate_q_basic_core
+{
+ public:
+  static constexpr int64_t RESEED_INTERVAL = ReseedInterval;
+  static constexpr size_t MAXIMUM_EVENT_SIZE = 32;
+  static constexpr size_t MAXIMUM_OUTPUT = 1048576;
+  static constexpr size_t MIN_POOL_SIZE = MinPoolSize;
+  static constexpr size_t POOLS = Pools;
+  typedef ReseedPolicy reseed_policy_type;
+
+  static_assert(Pools > 0 && Pools <= 64, "Pools must be 1 through 64.");
+  static_assert(ReseedInterval >= 0, "ReseedInterval must not be negative.");
+
+  struct generator_state
+  {
+    std::array<uint8_t, 32> m_key;
+    counter_q m_counter;
+  };
+
+  fortunate_q_basic_core(void):m_policy(MinPoolSize, ReseedInterval)
+  {
+    m_state->m_G = initialize_generator();
+    m_fork_generation = fork_generation().load(std::memory_order_relaxed);
+    m_new_bytes = 0;
+    m_reseed_count = 0;
+  }
+
+  static uint64_t forks(void)
+  {
+    /*
+    ** Incremented in every child process.
+    */
+
+    return fork_generation().load(std::memory_order_relaxed);
+  }
+
+  static bool pseudo_random_data(uint8_t *data,
+				 const size_t n,
+				 generator_state &G)
+  {
+    /*
+    ** The output is written directly into data. At most MAXIMUM_OUTPUT
+    ** bytes are produced before the key is replaced. One key schedule
+    ** serves the output and the new key.
+    */
+
+    if(G.m_counter.is_zero() || MAXIMUM_OUTPUT < n || !data)
+      return false;
+
+    aes256 aes(G.m_key.data());
+    auto const k = n / 16;
+    uint8_t block[32];
+
+    generate_blocks(aes, data, k, G.m_counter);
+
+    if(n % 16)
+      {
+	generate_blocks(aes, block, 1, G.m_counter);
+	memcpy(data + 16 * k, block, n % 16);
+      }
+
+    generate_blocks(aes, block, 2, G.m_counter);
+    memcpy(G.m_key.data(), block, G.m_key.size());
+    memset(block, 0, sizeof(block));
+    return true;
+  }
+
+  static bool pseudo_random_data_batch(uint8_t *const *outputs,
+				       const size_t *sizes,
+				       const size_t count,
+				       generator_state &G)
+  {
+    /*
+    ** Request i is written into outputs[i]. The key is replaced after
+    ** every request, so that one caller's output cannot be recovered
+    ** from another's. Nothing is written unless every request is valid.
+    */
+
+    if(G.m_counter.is_zero() || !outputs || !sizes)
+      return false;
+
+    for(size_t i = 0; i < count; i++)
+      if(MAXIMUM_OUTPUT < sizes[i] || (!outputs[i] && sizes[i] > 0))
+	return false;
+
+    for(size_t i = 0; i < count; i++)
+      if(sizes[i] > 0 && !pseudo_random_data(outputs[i], sizes[i], G))
+	return false;
+
+    return true;
+  }
+
+  static generator_state initialize_generator(void)
+  {
+    /*
+    ** What is a zero key?
+    */
+
+    generator_state G;
+
+    G.m_key.fill('0');
+    return G;
+  }
+
+  static void reseed(const uint8_t *s, const size_t n, generator_state &G)
+  {
+    sha256 context;
+
+    G.m_counter.increment();
+    context.update(G.m_key.data(), G.m_key.size());
+    context.update(s, n);
+    context.final(G.m_key.data());
+  }
+
+  bool add_random_event(const size_t i,
+			const int s,
+			const uint8_t *e,
+			const size_t size)
+  {
+    /*
+    ** The pools are hashed as the events arrive, so that each pool
+    ** occupies a fixed amount of memory. As in the Fortuna paper, an
+    ** event is its source byte, its length byte, and 1 to 32 bytes of
+    ** data. Longer data must be condensed first.
+    */
+
+    if(MAXIMUM_EVENT_SIZE < size || POOLS <= i || size == 0 || !e)
+      return false;
+
+    uint8_t const header[2] = {static_cast<uint8_t> (s),
+			       static_cast<uint8_t> (size)};
+
+    m_new_bytes += size;
+    m_state->m_P[i].update(header, sizeof(header));
+    m_state->m_P[i].update(e, size);
+    return true;
+  }
+
+  bool add_condensed_event(const size_t i,
+			   const int s,
+			   const uint8_t *e,
+			   const size_t size)
+  {
+    /*
+    ** Adds the SHA-256 digest of e, whatever its size.
+    */
+
+    if(POOLS <= i || size == 0 || !e)
+      return false;
+
+    uint8_t digest[sha256::DIGEST_SIZE];
+
+    sha256::hash(e, size, digest);
+
+    auto const ok = add_random_event(i, s, digest, sizeof(digest));
+
+    memset(digest, 0, sizeof(digest));
+    return ok;
+  }
+
+  bool generate(uint8_t *data, const size_t n)
+  {
+    /*
+    ** Output without a reseed. The generator must have been seeded.
+    */
+
+    return m_reseed_count > 0 && pseudo_random_data(data, n, m_state->m_G);
+  }
+
+  bool generate_batch(uint8_t *const *outputs,
+		      const size_t *sizes,
+		      const size_t count)
+  {
+    return m_reseed_count > 0 &&
+      pseudo_random_data_batch(outputs, sizes, count, m_state->m_G);
+  }
+
+  bool random_data(uint8_t *data, const size_t n)
+  {
+    rekey_if_forked();
+    reseed_if_necessary();
+    return generate(data, n);
+  }
+
+  bool random_data_batch(uint8_t *const *outputs,
+			 const size_t *sizes,
+			 const size_t count)
+  {
+    /*
+    ** One fork check and one reseed check serve every request.
+    */
+
+    rekey_if_forked();
+    reseed_if_necessary();
+    return generate_batch(outputs, sizes, count);
+  }
+
+  bool reseed_if_necessary(void)
+  {
+    auto const now = std::chrono::steady_clock::now();
+
+    if(m_reseed_count == 0 ||
+       m_policy.should_reseed
+       (now, m_last_reseed, m_state->m_P[0].size(), m_new_bytes))
+      {
+	uint8_t s[POOLS * sha256::DIGEST_SIZE];
+
+	m_reseed_count += 1;
+
+	/*
+	** Pool i takes part if 2^i divides the reseed count. The pools
+	** 0 through the number of trailing zero bits therefore take part.
+	*/
+
+	auto const pools = participants
+	  (static_cast<uint64_t> (m_reseed_count));
+
+	for(size_t i = 0; i < pools; i++)
+	  m_state->m_P[i].final(s + i * sha256::DIGEST_SIZE);
+
+	reseed(s, pools * sha256::DIGEST_SIZE, m_state->m_G);
+	memset(s, 0, pools * sha256::DIGEST_SIZE);
+	m_last_reseed = std::chrono::steady_clock::now();
+	m_new_bytes = 0;
+	m_policy.reseeded();
+	return true;
+      }
+
+    return false;
+  }
+
+  ReseedPolicy &reseed_policy(void)
+  {
+    return m_policy;
+  }
+
+  uint64_t pool_size(const size_t i) const
+  {
+    /*
+    ** Bytes added to pool i since it last took part in a reseed.
+    */
+
+    return i < POOLS ? m_state->m_P[i].size() : 0;
+  }
+
+  void reseed(const uint8_t *s, const size_t n)
+  {
+    /*
+    ** Mixes s into the generator directly, as with a seed file.
+    */
+
+    reseed(s, n, m_state->m_G);
+  }
+
+  void set_reseed_count(const uint64_t count)
+  {
+    /*
+    ** For benchmarks and tests. The next reseed is reseed count + 1 and
+    ** draws on the pools which that count selects.
+    */
+
+    m_reseed_count = count;
+  }
+
+  void rekey_if_forked(void)
+  {
+    auto const generation =
+      fork_generation().load(std::memory_order_relaxed);
+
+    if(generation == m_fork_generation)
+      return;
+
+    /*
+    ** The child inherited the parent's key and counter. The parent's
+    ** next output is public once the parent emits it, so the key which
+    ** preceded it and fresh entropy from the system are mixed in as
+    ** well, with the child's identifier. The pools are preserved.
+    */
+
+    char pid[32];
+    uint8_t s[96 + sizeof(pid)];
+    size_t n = 0;
+
+    m_fork_generation = generation;
+    memcpy(s, m_state->m_G.m_key.data(), m_state->m_G.m_key.size());
+    n += m_state->m_G.m_key.size();
+
+    if(!m_state->m_G.m_counter.is_zero() &&
+       pseudo_random_data(s + n, 32, m_state->m_G))
+      n += 32;
+
+#if defined(__APPLE__) || defined(__linux__)
+    if(getentropy(s + n, 32) == 0)
+      n += 32;
+#endif
+
+#if defined(__APPLE__) || defined(__unix__)
+    auto const length = snprintf
+      (pid, sizeof(pid), "%lld", static_cast<long long> (getpid()));
+
+    if(length > 0)
+      {
+	memcpy(s + n, pid, static_cast<size_t> (length));
+	n += static_cast<size_t> (length);
+      }
+#else
+    static_cast<void> (pid);
+#endif
+
+    reseed(s, n, m_state->m_G);
+    memset(s, 0, sizeof(s));
+  }
+
+ private:
+  struct secure_state
+  {
+    generator_state m_G;
+    sha256 m_P[Pools];
+  };
+
+  ReseedPolicy m_policy;
+  fortunate_q_secure<secure_state> m_state; // Erased by the arena.
+  std::chrono::steady_clock::time_point m_last_reseed;
+  uint64_t m_fork_generation;
+  uint64_t m_new_bytes;
+#ifndef __SIZEOF_INT128__
+  uint64_t m_reseed_count;
+#else
+  unsigned __int128 m_reseed_count;
+#endif
+
+  static void generate_blocks(aes256 &aes,
+			      uint8_t *data,
+			      const size_t k,
+			      counter_q &counter)
+  {
+    uint8_t value[16];
+
+    for(size_t i = 0; i < k; i++)
+      {
+	counter.value(value);
+	aes.encrypt_block(value, data + 16 * i);
+	counter.increment();
+      }
+  }
+
+  static std::atomic<uint64_t> &fork_generation(void)
+  {
+    /*
+    ** Incremented in every child process. The handler is registered
+    ** once per process.
+    */
+
+    static std::atomic<uint64_t> generation(0);
+#if defined(__APPLE__) || defined(__unix__)
+    static auto const registered =
+      pthread_atfork(nullptr, nullptr, &fork_child) == 0;
+
+    static_cast<void> (registered);
+#endif
+    return generation;
+  }
+
+  static void fork_child(void)
+  {
+    fork_generation().fetch_add(1, std::memory_order_relaxed);
+  }
+
+  static size_t participants(const uint64_t count)
+  {
+    /*
+    ** The low 64 bits of the reseed count suffice for 64 pools.
+    */
+
+    if(count == 0)
+      return POOLS;
+
+#if defined(__GNUC__)
+    auto const zeros = static_cast<size_t> (__builtin_ctzll(count));
+#else
+    size_t zeros = 0;
+
+    while(((count >> zeros) & 1) == 0)
+      zeros += 1;
+#endif
+
+    return zeros + 1 < POOLS ? zeros + 1 : POOLS;
+  }
+};
+
+typedef fortunate_q_basic_core<FORTUNATE_Q_POOLS,
+			       FORTUNATE_Q_MIN_POOL_SIZE,
+			       FORTUNATE_Q_RESEED_INTERVAL> fortunate_q_core;
+
+#endif
@@ -0,0 +1,181 @@
+/*
+** Copyright (c) 2023, Alexis Megas.
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from FortunateQ without specific prior written permission.
+**
+** FORTUNATEQ IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** FORTUNATEQ, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _fortunate_q_device_h_
+#define _fortunate_q_device_h_
+
+#include "fortunate-q.h"
+
+#include <QIODevice>
+
+/*
+** An endless, read-only, sequential device. Reads of at least
+** buffer_size() bytes are generated directly into the caller's memory.
+** Smaller reads are served from an internal buffer in the locked arena.
+** The device is always opened unbuffered so that QIODevice does not copy
+** the data again.
+*/
+
+class fortunate_q_device: public QIODevice
+{
+  Q_OBJECT
+
+ public:
+  fortunate_q_device(fortunate_q *f, QObject *parent):QIODevice(parent)
+  {
+    m_buffer = nullptr;
+    m_buffer_length = 0;
+    m_buffer_size = 65536;
+    m_f = f;
+    m_position = 0;
+  }
+
+  ~fortunate_q_device()
+  {
+    release_buffer();
+  }
+
+  bool isSequential(void) const
+  {
+    return true;
+  }
+
+  bool open(QIODevice::OpenMode mode)
+  {
+    if(mode & QIODevice::WriteOnly)
+      return false;
+
+    release_buffer();
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+  }
+
+  int buffer_size(void) const
+  {
+    return m_buffer_size;
+  }
+
+  qint64 bytesAvailable(void) const
+  {
+    return QIODevice::bytesAvailable() + m_buffer_length - m_position;
+  }
+
+  void close(void)
+  {
+    release_buffer();
+    QIODevice::close();
+  }
+
+  void set_buffer_size(const int buffer_size)
+  {
+    release_buffer();
+    m_buffer_size = qBound(16, buffer_size, 1048576);
+  }
+
+ protected:
+  qint64 readData(char *data, qint64 maxSize)
+  {
+    if(!data || !m_f || maxSize < 0)
+      return -1;
+
+    qint64 i = 0;
+
+    if(m_position < m_buffer_length)
+      {
+	auto const n = qMin
+	  (maxSize, static_cast<qint64> (m_buffer_length - m_position));
+
+	memcpy(data, m_buffer + m_position, static_cast<size_t> (n));
+	memset(m_buffer + m_position, 0, static_cast<size_t> (n));
+	i += n;
+	m_position += static_cast<int> (n);
+      }
+
+    while(maxSize - i >= m_buffer_size)
+      {
+	auto const n = static_cast<int>
+	  (qMin(maxSize - i, static_cast<qint64> (1048576)));
+
+	if(!m_f->random_data(data + i, n))
+	  return i > 0 ? i : -1;
+
+	i += n;
+      }
+
+    if(i < maxSize)
+      {
+	if(!m_buffer)
+	  m_buffer = static_cast<char *>
+	    (fortunate_q_arena::instance().allocate
+	     (static_cast<size_t> (m_buffer_size)));
+
+	m_buffer_length = 0;
+	m_position = 0;
+
+	if(!m_buffer || !m_f->random_data(m_buffer, m_buffer_size))
+	  return i > 0 ? i : -1;
+
+	auto const n = maxSize - i;
+
+	m_buffer_length = m_buffer_size;
+	memcpy(data + i, m_buffer, static_cast<size_t> (n));
+	memset(m_buffer, 0, static_cast<size_t> (n));
+	i += n;
+	m_position = static_cast<int> (n);
+      }
+
+    return i;
+  }
+
+  qint64 writeData(const char *data, qint64 maxSize)
+  {
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+  }
+
+ private:
+  QPointer<fortunate_q> m_f;
+  char *m_buffer;
+  int m_buffer_length;
+  int m_buffer_size;
+  int m_position;
+
+  void release_buffer(void)
+  {
+    /*
+    ** The arena erases the buffer.
+    */
+
+    fortunate_q_arena::instance().release
+      (m_buffer, static_cast<size_t> (m_buffer_size));
+    m_buffer = nullptr;
+    m_buffer_length = 0;
+    m_position = 0;
+  }
+};
+
+#endif
@@ -0,0 +1,408 @@
+/*
+** Copyright (c) 2023, Alexis Megas.
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from FortunateQ without specific prior written permission.
+**
+** FORTUNATEQ IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** FORTUNATEQ, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _fortunate_q_numa_h_
+#define _fortunate_q_numa_h_
+
+#include "fortunate-q-core.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+#if defined(__APPLE__) || defined(__unix__)
+#include <pthread.h>
+#endif
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+/*
+** One generator per NUMA node. Each generator is allocated on its node
+** and has its own lock. A caller is served by the generator of the node
+** on which it is running. The pools and the sources are shared in one
+** root Fortuna. A shard checks the root at most once per reseed interval.
+** It takes a new key from the root whenever the root has reseeded since
+** the shard's last key. This class is thread-safe, and its locks are
+** held across fork() so that a child does not inherit a held lock. Nodes
+** are discovered on Linux; elsewhere there is a single shard.
+*/
+
+template<typename Core>
+class fortunate_q_basic_numa
+{
+ public:
+  fortunate_q_basic_numa(void)
+  {
+    auto const nodes(online_nodes());
+
+    m_generation = 1;
+
+    for(size_t i = 0; i < nodes.size(); i++)
+      {
+	auto data = fortunate_q_arena::instance().allocate_node
+	  (sizeof(shard), nodes[i]);
+
+	if(!data)
+	  continue;
+
+	m_shards.push_back(new (data) shard());
+
+	for(auto const cpu : node_cpus(nodes[i]))
+	  {
+	    if(cpu >= static_cast<int> (m_cpu_shards.size()))
+	      m_cpu_shards.resize(static_cast<size_t> (cpu) + 1, 0);
+
+	    m_cpu_shards[static_cast<size_t> (cpu)] = m_shards.size() - 1;
+	  }
+      }
+
+    if(m_shards.empty())
+      {
+	auto data = fortunate_q_arena::instance().allocate(sizeof(shard));
+
+	if(!data)
+	  throw std::bad_alloc();
+
+	m_shards.push_back(new (data) shard());
+      }
+
+    std::lock_guard<std::mutex> lock(instances_mutex());
+
+    instances().push_back(this);
+  }
+
+  ~fortunate_q_basic_numa()
+  {
+    {
+      std::lock_guard<std::mutex> lock(instances_mutex());
+      auto &list(instances());
+
+      for(size_t i = 0; i < list.size(); i++)
+	if(list[i] == this)
+	  {
+	    list[i] = list.back();
+	    list.pop_back();
+	    break;
+	  }
+    }
+
+    for(auto s : m_shards)
+      {
+	s->~shard();
+	fortunate_q_arena::instance().release(s, sizeof(shard));
+      }
+  }
+
+  fortunate_q_basic_numa(const fortunate_q_basic_numa &) = delete;
+  fortunate_q_basic_numa &operator=(const fortunate_q_basic_numa &) = delete;
+
+  static bool bind_thread(const int node)
+  {
+    /*
+    ** Restricts the calling thread to the processors of node, for
+    ** example an ingestion thread near its device.
+    */
+
+#if defined(__linux__)
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+
+    for(auto const cpu : node_cpus(node))
+      if(cpu < CPU_SETSIZE)
+	CPU_SET(cpu, &set);
+
+    return CPU_COUNT(&set) > 0 &&
+      pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    static_cast<void> (node);
+    return false;
+#endif
+  }
+
+  static int device_node(const std::string &device)
+  {
+    /*
+    ** The node of a device, e.g., /sys/class/net/eth0/device. Returns
+    ** -1 if the node is not known.
+    */
+
+    std::ifstream file(device + "/numa_node");
+    int node = -1;
+
+    if(!(file >> node))
+      return -1;
+
+    return node;
+  }
+
+  bool add_condensed_event(const size_t i,
+			   const int s,
+			   const uint8_t *e,
+			   const size_t size)
+  {
+    std::lock_guard<std::mutex> lock(m_root_mutex);
+
+    return m_root.add_condensed_event(i, s, e, size);
+  }
+
+  bool add_random_event(const size_t i,
+			const int s,
+			const uint8_t *e,
+			const size_t size)
+  {
+    std::lock_guard<std::mutex> lock(m_root_mutex);
+
+    return m_root.add_random_event(i, s, e, size);
+  }
+
+  bool random_data(uint8_t *data, const size_t n)
+  {
+    auto &s(*m_shards[current_shard()]);
+    std::lock_guard<std::mutex> lock(s.m_mutex);
+
+    return refresh(s) && Core::pseudo_random_data(data, n, s.m_G);
+  }
+
+  bool random_data_batch(uint8_t *const *outputs,
+			 const size_t *sizes,
+			 const size_t count)
+  {
+    auto &s(*m_shards[current_shard()]);
+    std::lock_guard<std::mutex> lock(s.m_mutex);
+
+    return refresh(s) &&
+      Core::pseudo_random_data_batch(outputs, sizes, count, s.m_G);
+  }
+
+  void set_reseed_policy(const typename Core::reseed_policy_type &policy)
+  {
+    std::lock_guard<std::mutex> lock(m_root_mutex);
+
+    m_root.reseed_policy() = policy;
+  }
+
+  size_t shards(void) const
+  {
+    return m_shards.size();
+  }
+
+  void reseed(const uint8_t *s, const size_t n)
+  {
+    std::lock_guard<std::mutex> lock(m_root_mutex);
+
+    m_root.reseed(s, n);
+    m_generation += 1;
+  }
+
+ private:
+  struct shard
+  {
+    std::chrono::steady_clock::time_point m_checked;
+    std::mutex m_mutex;
+    typename Core::generator_state m_G = Core::initialize_generator();
+    uint64_t m_forks = 0;
+    uint64_t m_generation = 0;
+  };
+
+  Core m_root;
+  std::mutex m_root_mutex;
+  std::vector<shard *> m_shards;
+  std::vector<size_t> m_cpu_shards;
+  uint64_t m_generation; // Protected by m_root_mutex.
+
+  static std::mutex &instances_mutex(void)
+  {
+    static std::mutex mutex;
+
+    return mutex;
+  }
+
+  static std::vector<fortunate_q_basic_numa *> &instances(void)
+  {
+    /*
+    ** The live instances, protected by instances_mutex(). The fork
+    ** handlers are registered once per process.
+    */
+
+    static std::vector<fortunate_q_basic_numa *> instances;
+#if defined(__APPLE__) || defined(__unix__)
+    static auto const registered =
+      pthread_atfork(&fork_prepare, &fork_parent, &fork_child) == 0;
+
+    static_cast<void> (registered);
+#endif
+    return instances;
+  }
+
+  static void fork_child(void)
+  {
+    fork_parent();
+  }
+
+  static void fork_parent(void)
+  {
+    for(auto n : instances())
+      {
+	n->m_root_mutex.unlock();
+
+	for(auto s : n->m_shards)
+	  s->m_mutex.unlock();
+      }
+
+    instances_mutex().unlock();
+  }
+
+  static void fork_prepare(void)
+  {
+    /*
+    ** A shard's lock is taken before the root's, as in refresh().
+    */
+
+    instances_mutex().lock();
+
+    for(auto n : instances())
+      {
+	for(auto s : n->m_shards)
+	  s->m_mutex.lock();
+
+	n->m_root_mutex.lock();
+      }
+  }
+
+  static std::vector<int> node_cpus(const int node)
+  {
+    return parse_list
+      ("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+  }
+
+  static std::vector<int> online_nodes(void)
+  {
+    return parse_list("/sys/devices/system/node/online");
+  }
+
+  static std::vector<int> parse_list(const std::string &file_name)
+  {
+    /*
+    ** Lists such as 0-3,8-11.
+    */
+
+    std::ifstream file(file_name);
+    std::string list;
+    std::vector<int> values;
+
+    if(!std::getline(file, list))
+      return values;
+
+    auto p = list.c_str();
+
+    while(*p)
+      {
+	char *end = nullptr;
+	auto const first = std::strtol(p, &end, 10);
+	auto last = first;
+
+	if(end == p)
+	  break;
+	else if(*end == '-')
+	  {
+	    p = end + 1;
+	    last = std::strtol(p, &end, 10);
+
+	    if(end == p)
+	      break;
+	  }
+
+	for(auto j = first; j <= last && j >= 0 && j < 65536; j++)
+	  values.push_back(static_cast<int> (j));
+
+	p = *end == ',' ? end + 1 : end;
+
+	if(*end != ',')
+	  break;
+      }
+
+    return values;
+  }
+
+  size_t current_shard(void) const
+  {
+#if defined(__linux__)
+    auto const cpu = sched_getcpu();
+
+    if(cpu >= 0 && static_cast<size_t> (cpu) < m_cpu_shards.size())
+      return m_cpu_shards[static_cast<size_t> (cpu)];
+#endif
+
+    return 0;
+  }
+
+  bool refresh(shard &s)
+  {
+    /*
+    ** The caller holds the shard's lock.
+    */
+
+    auto const forks = Core::forks();
+    auto const now = std::chrono::steady_clock::now();
+
+    if(s.m_forks != forks ||
+       s.m_generation == 0 ||
+       now - s.m_checked >= std::chrono::milliseconds(Core::RESEED_INTERVAL))
+      {
+	std::lock_guard<std::mutex> lock(m_root_mutex);
+
+	m_root.rekey_if_forked();
+
+	if(m_root.reseed_if_necessary())
+	  m_generation += 1;
+
+	if(s.m_forks != forks || s.m_generation != m_generation)
+	  {
+	    if(!m_root.generate(s.m_G.m_key.data(), s.m_G.m_key.size()))
+	      return false;
+
+	    s.m_G.m_counter.increment();
+	    s.m_forks = forks;
+	    s.m_generation = m_generation;
+	  }
+
+	s.m_checked = now;
+      }
+
+    return true;
+  }
+};
+
+typedef fortunate_q_basic_numa<fortunate_q_core> fortunate_q_numa;
+
+#endif
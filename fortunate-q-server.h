@@ -0,0 +1,246 @@
+/*
+** Copyright (c) 2023, Alexis Megas.
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from FortunateQ without specific prior written permission.
+**
+** FORTUNATEQ IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** FORTUNATEQ, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _fortunate_q_server_h_
+#define _fortunate_q_server_h_
+
+#include "fortunate-q.h"
+
+#include <QHash>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QQueue>
+#include <QtEndian>
+
+/*
+** Protocol:
+** A request is a 32-bit big-endian byte count, 1 to 1048576 inclusive.
+** The response is exactly that many bytes. Requests may be pipelined and
+** are answered in order. Malformed requests terminate the connection.
+** A connection is not read from while it has too many requests or bytes
+** outstanding. Reading resumes as its responses are written.
+*/
+
+static const int MAXIMUM_REQUEST_SIZE = 1048576;
+static const qint64 MAXIMUM_PENDING_BYTES = 4 * MAXIMUM_REQUEST_SIZE;
+static const int MAXIMUM_PENDING_REQUESTS = 256;
+
+class fortunate_q_server: public QObject
+{
+  Q_OBJECT
+
+ public:
+  fortunate_q_server(fortunate_q *f, QObject *parent):QObject(parent)
+  {
+    m_batch_timer.setInterval(0);
+    m_batch_timer.setSingleShot(true);
+    m_f = f;
+    connect(&m_batch_timer,
+	    &QTimer::timeout,
+	    this,
+	    &fortunate_q_server::slot_process_requests);
+    connect(&m_server,
+	    &QLocalServer::newConnection,
+	    this,
+	    &fortunate_q_server::slot_new_connection);
+  }
+
+  ~fortunate_q_server()
+  {
+    m_batch_timer.stop();
+    m_server.close();
+  }
+
+  bool listen(const QString &name)
+  {
+    if(name.trimmed().isEmpty())
+      return false;
+
+    m_server.close();
+    m_server.setSocketOptions(QLocalServer::UserAccessOption);
+    QLocalServer::removeServer(name.trimmed());
+    return m_server.listen(name.trimmed());
+  }
+
+ private:
+  struct pending
+  {
+    int m_requests = 0;
+    qint64 m_bytes = 0;
+  };
+
+  struct request
+  {
+    QPointer<QLocalSocket> m_socket;
+    int m_size;
+  };
+
+  QHash<QLocalSocket *, pending> m_pending;
+  QLocalServer m_server;
+  QPointer<fortunate_q> m_f;
+  QQueue<request> m_requests;
+  QTimer m_batch_timer;
+
+ private slots:
+  void slot_disconnected(void)
+  {
+    auto socket = qobject_cast<QLocalSocket *> (sender());
+
+    if(socket)
+      {
+	m_pending.remove(socket);
+	socket->deleteLater();
+      }
+  }
+
+  void slot_new_connection(void)
+  {
+    while(m_server.hasPendingConnections())
+      {
+	auto socket = m_server.nextPendingConnection();
+
+	if(!socket)
+	  break;
+
+	connect(socket,
+		&QLocalSocket::bytesWritten,
+		this,
+		&fortunate_q_server::slot_ready_read);
+	connect(socket,
+		&QLocalSocket::disconnected,
+		this,
+		&fortunate_q_server::slot_disconnected);
+	connect(socket,
+		&QLocalSocket::readyRead,
+		this,
+		&fortunate_q_server::slot_ready_read);
+	m_pending[socket] = pending();
+	socket->setReadBufferSize(4096);
+      }
+  }
+
+  void slot_process_requests(void)
+  {
+    /*
+    ** Requests which arrived during the same event-loop iteration
+    ** are served by a single batch. The generator is rekeyed between
+    ** requests, so that clients do not share a key.
+    */
+
+    while(!m_requests.isEmpty() && m_f)
+      {
+	QQueue<request> batch;
+	QVector<char *> outputs;
+	QVector<int> sizes;
+	int size = 0;
+
+	while(!m_requests.isEmpty() &&
+	      MAXIMUM_REQUEST_SIZE - size >= m_requests.head().m_size)
+	  {
+	    size += m_requests.head().m_size;
+	    sizes << m_requests.head().m_size;
+	    batch.enqueue(m_requests.dequeue());
+	  }
+
+	QByteArray data(size, 0);
+	int offset = 0;
+
+	for(int i = 0; i < sizes.size(); i++)
+	  {
+	    outputs << data.data() + offset;
+	    offset += sizes.at(i);
+	  }
+
+	auto const ok = m_f->random_data_batch
+	  (outputs.constData(), sizes.constData(), sizes.size());
+
+	offset = 0;
+
+	while(!batch.isEmpty())
+	  {
+	    auto const r(batch.dequeue());
+
+	    if(r.m_socket)
+	      {
+		auto const it = m_pending.find(r.m_socket.data());
+
+		if(it != m_pending.end())
+		  {
+		    it->m_bytes -= r.m_size;
+		    it->m_requests -= 1;
+		  }
+
+		if(ok)
+		  r.m_socket->write(data.constData() + offset, r.m_size);
+		else
+		  r.m_socket->abort();
+	      }
+
+	    offset += r.m_size;
+	  }
+
+	data.fill(0);
+      }
+  }
+
+  void slot_ready_read(void)
+  {
+    auto socket = qobject_cast<QLocalSocket *> (sender());
+
+    if(!socket || !m_pending.contains(socket))
+      return;
+
+    auto &p(m_pending[socket]);
+
+    while(socket->bytesAvailable() >= 4)
+      {
+	if(MAXIMUM_PENDING_BYTES <= p.m_bytes + socket->bytesToWrite() ||
+	   MAXIMUM_PENDING_REQUESTS <= p.m_requests)
+	  break;
+
+	quint32 size = 0;
+
+	socket->read(reinterpret_cast<char *> (&size), 4);
+	size = qFromBigEndian(size);
+
+	if(size == 0 || size > static_cast<quint32> (MAXIMUM_REQUEST_SIZE))
+	  {
+	    socket->abort();
+	    return;
+	  }
+
+	m_requests.enqueue(request{socket, static_cast<int> (size)});
+	p.m_bytes += static_cast<qint64> (size);
+	p.m_requests += 1;
+      }
+
+    if(!m_requests.isEmpty())
+      m_batch_timer.start();
+  }
+};
+
+#endif
@@ -0,0 +1,364 @@
+/*
+** Copyright (c) 2023, Alexis Megas.
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from FortunateQ without specific prior written permission.
+**
+** FORTUNATEQ IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** FORTUNATEQ, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _fortunate_q_shared_memory_h_
+#define _fortunate_q_shared_memory_h_
+
+#include "fortunate-q.h"
+
+#include <QSharedMemory>
+
+#include <cerrno>
+#include <limits>
+#include <new>
+
+#ifdef Q_OS_UNIX
+#include <signal.h>
+#endif
+
+/*
+** A ring of cells in shared memory. The writer fills empty cells with
+** fresh output. Readers claim whole cells with an atomic cursor, copy them,
+** and erase them, so that a cell is never given to two readers. A ring
+** whose magic is cleared is closed and readers stop.
+*/
+
+static const int SHARED_MEMORY_CELL_SIZE = 32;
+static const quint64 SHARED_MEMORY_MAGIC = 0x66712d72696e6701ULL;
+
+struct alignas(64) fortunate_q_shared_memory_cell
+{
+  std::atomic<quint64> m_sequence;
+  char m_data[SHARED_MEMORY_CELL_SIZE];
+};
+
+struct fortunate_q_shared_memory_header
+{
+  qint64 m_owner; // The writer's process identifier.
+  quint64 m_cells;
+  std::atomic<quint64> m_magic;
+  alignas(64) std::atomic<quint64> m_read;
+  alignas(64) std::atomic<quint64> m_write;
+};
+
+static_assert(std::atomic<quint64>::is_always_lock_free,
+	      "Shared memory requires lock-free 64-bit atomics.");
+
+class fortunate_q_shared_memory_reader
+{
+ public:
+  fortunate_q_shared_memory_reader(const QString &key):m_memory(key)
+  {
+    m_cells = nullptr;
+    m_header = nullptr;
+
+    if(m_memory.attach(QSharedMemory::ReadWrite))
+      {
+	auto header = static_cast<fortunate_q_shared_memory_header *>
+	  (m_memory.data());
+
+	if(header->m_magic.load(std::memory_order_acquire) ==
+	   SHARED_MEMORY_MAGIC &&
+	   static_cast<quint64> (m_memory.size()) >=
+	   sizeof(*header) + header->m_cells * sizeof(*m_cells))
+	  {
+	    m_cells = reinterpret_cast<fortunate_q_shared_memory_cell *>
+	      (header + 1);
+	    m_header = header;
+	  }
+      }
+  }
+
+  ~fortunate_q_shared_memory_reader()
+  {
+    m_memory.detach();
+  }
+
+  bool is_attached(void) const
+  {
+    return m_header != nullptr;
+  }
+
+  qint64 read(char *data, const qint64 n)
+  {
+    /*
+    ** Returns the number of bytes copied. Fewer than n bytes are
+    ** returned if the ring is empty or closed. System calls are not
+    ** made.
+    */
+
+    if(!data || !m_header || n <= 0)
+      return 0;
+
+    qint64 i = 0;
+
+    while(i < n)
+      {
+	auto const cells = m_header->m_cells;
+	auto position = m_header->m_read.load(std::memory_order_relaxed);
+	fortunate_q_shared_memory_cell *cell = nullptr;
+
+	for(;;)
+	  {
+	    if(m_header->m_magic.load(std::memory_order_acquire) !=
+	       SHARED_MEMORY_MAGIC)
+	      return i; // Closed.
+
+	    cell = &m_cells[position % cells];
+
+	    auto const difference = static_cast<qint64>
+	      (cell->m_sequence.load(std::memory_order_acquire) -
+	       (position + 1));
+
+	    if(difference == 0)
+	      {
+		if(m_header->m_read.compare_exchange_weak
+		   (position, position + 1, std::memory_order_relaxed))
+		  break;
+	      }
+	    else if(difference < 0)
+	      return i; // Empty.
+	    else
+	      position = m_header->m_read.load(std::memory_order_relaxed);
+	  }
+
+	auto const size = qMin
+	  (n - i, static_cast<qint64> (SHARED_MEMORY_CELL_SIZE));
+
+	memcpy(data + i, cell->m_data, static_cast<size_t> (size));
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	/*
+	** The writer clears the magic before it erases the cells. A copy
+	** which may have been erased is discarded.
+	*/
+
+	if(m_header->m_magic.load(std::memory_order_relaxed) !=
+	   SHARED_MEMORY_MAGIC)
+	  {
+	    memset(data + i, 0, static_cast<size_t> (size));
+	    return i;
+	  }
+
+	memset(cell->m_data, 0, sizeof(cell->m_data));
+
+	/*
+	** The cell is returned only if the ring was not closed or
+	** recreated in the meantime.
+	*/
+
+	auto expected = position + 1;
+
+	cell->m_sequence.compare_exchange_strong
+	  (expected, position + cells, std::memory_order_release);
+	i += size;
+      }
+
+    return i;
+  }
+
+ private:
+  QSharedMemory m_memory;
+  fortunate_q_shared_memory_cell *m_cells;
+  fortunate_q_shared_memory_header *m_header;
+};
+
+class fortunate_q_shared_memory_writer: public QObject
+{
+  Q_OBJECT
+
+ public:
+  fortunate_q_shared_memory_writer(const QString &key,
+				   fortunate_q *f,
+				   QObject *parent):QObject(parent),
+						    m_memory(key)
+  {
+    m_cells = nullptr;
+    m_f = f;
+    m_header = nullptr;
+    connect(&m_refill_timer,
+	    &QTimer::timeout,
+	    this,
+	    &fortunate_q_shared_memory_writer::slot_refill);
+  }
+
+  ~fortunate_q_shared_memory_writer()
+  {
+    m_refill_timer.stop();
+
+    if(m_header)
+      {
+	/*
+	** Readers stop once the magic is cleared. No cell is full
+	** afterwards, so that an erased cell cannot be claimed.
+	*/
+
+	m_header->m_magic.store(0, std::memory_order_seq_cst);
+
+	for(quint64 i = 0; i < m_header->m_cells; i++)
+	  m_cells[i].m_sequence.store(0, std::memory_order_relaxed);
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	for(quint64 i = 0; i < m_header->m_cells; i++)
+	  memset(m_cells[i].m_data, 0, sizeof(m_cells[i].m_data));
+      }
+
+    m_memory.detach();
+  }
+
+  bool publish(const int cells, const int interval)
+  {
+    /*
+    ** Creates the ring and refills it every interval milliseconds. A
+    ** ring whose writer is alive is not taken over.
+    */
+
+    if(cells <= 0 || interval <= 0 || m_header)
+      return false;
+
+    auto const size = static_cast<qint64>
+      (sizeof(*m_header) + static_cast<size_t> (cells) * sizeof(*m_cells));
+
+    if(size > std::numeric_limits<int>::max())
+      return false;
+
+    if(!m_memory.create(static_cast<int> (size)))
+      {
+	/*
+	** A previous writer may have left the segment behind.
+	*/
+
+	if(m_memory.error() != QSharedMemory::AlreadyExists ||
+	   !m_memory.attach())
+	  return false;
+	else if(m_memory.size() < size ||
+		is_live(static_cast<fortunate_q_shared_memory_header *>
+			(m_memory.data())))
+	  {
+	    m_memory.detach();
+	    return false;
+	  }
+      }
+
+    m_header = new (m_memory.data()) fortunate_q_shared_memory_header;
+    m_header->m_cells = static_cast<quint64> (cells);
+    m_header->m_magic.store(0, std::memory_order_relaxed);
+    m_header->m_owner = QCoreApplication::applicationPid();
+    m_header->m_read.store(0, std::memory_order_relaxed);
+    m_header->m_write.store(0, std::memory_order_relaxed);
+    m_cells = reinterpret_cast<fortunate_q_shared_memory_cell *>
+      (m_header + 1);
+
+    for(int i = 0; i < cells; i++)
+      {
+	new (&m_cells[i]) fortunate_q_shared_memory_cell;
+	m_cells[i].m_sequence.store
+	  (static_cast<quint64> (i), std::memory_order_relaxed);
+	memset(m_cells[i].m_data, 0, sizeof(m_cells[i].m_data));
+      }
+
+    m_header->m_magic.store(SHARED_MEMORY_MAGIC, std::memory_order_release);
+    slot_refill();
+    m_refill_timer.start(interval);
+    return true;
+  }
+
+ private:
+  QPointer<fortunate_q> m_f;
+  QSharedMemory m_memory;
+  QTimer m_refill_timer;
+  fortunate_q_shared_memory_cell *m_cells;
+  fortunate_q_shared_memory_header *m_header;
+
+  static bool is_live(const fortunate_q_shared_memory_header *header)
+  {
+    /*
+    ** A ring is live if it is open and its writer exists.
+    */
+
+    if(header->m_magic.load(std::memory_order_acquire) != SHARED_MEMORY_MAGIC)
+      return false;
+
+#ifdef Q_OS_UNIX
+    return header->m_owner > 0 &&
+      (kill(static_cast<pid_t> (header->m_owner), 0) == 0 || errno == EPERM);
+#else
+    return true;
+#endif
+  }
+
+ private slots:
+  void slot_refill(void)
+  {
+    if(!m_f || !m_header)
+      return;
+
+    auto const cells = m_header->m_cells;
+    auto position = m_header->m_write.load(std::memory_order_relaxed);
+
+    for(;;)
+      {
+	/*
+	** Count the empty cells which follow the write cursor. Each pass
+	** requests fresh output, so that the generator is rekeyed.
+	*/
+
+	quint64 empty = 0;
+
+	while(empty < cells &&
+	      empty < static_cast<quint64> (1048576 / SHARED_MEMORY_CELL_SIZE) &&
+	      m_cells[(position + empty) % cells].m_sequence.load
+	      (std::memory_order_acquire) == position + empty)
+	  empty += 1;
+
+	if(empty == 0)
+	  break;
+
+	auto const data
+	  (m_f->random_data(static_cast<int> (empty) * SHARED_MEMORY_CELL_SIZE));
+
+	if(data.size() != static_cast<int> (empty) * SHARED_MEMORY_CELL_SIZE)
+	  break;
+
+	for(quint64 i = 0; i < empty; i++)
+	  {
+	    auto &cell(m_cells[(position + i) % cells]);
+
+	    memcpy(cell.m_data,
+		   data.constData() + i * SHARED_MEMORY_CELL_SIZE,
+		   sizeof(cell.m_data));
+	    cell.m_sequence.store(position + i + 1, std::memory_order_release);
+	  }
+
+	position += empty;
+	m_header->m_write.store(position, std::memory_order_relaxed);
+      }
+  }
+};
+
+#endif
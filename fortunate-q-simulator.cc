@@ -0,0 +1,145 @@
+/*
+** Copyright (c) 2023, Alexis Megas.
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from FortunateQ without specific prior written permission.
+**
+** FORTUNATEQ IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** FORTUNATEQ, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "fortunate-q-simulator.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+
+/*
+** Example:
+** fortunate-q-simulator --devices 64 --port 5000 --rate 65536 --burst 512
+** Each device listens on the loopback interface, one port after another.
+** Totals are written to stderr every second.
+*/
+
+int main(int argc, char *argv[])
+{
+  QCoreApplication application(argc, argv);
+  QCommandLineParser parser;
+
+  parser.addHelpOption();
+  parser.addOption
+    (QCommandLineOption("burst", "Bytes per burst.", "bytes", "32"));
+  parser.addOption
+    (QCommandLineOption("devices", "Number of devices.", "n", "1"));
+  parser.addOption
+    (QCommandLineOption("disconnect-interval",
+			"Milliseconds before a connection is dropped.",
+			"msecs",
+			"0"));
+  parser.addOption
+    (QCommandLineOption("keepalive-timeout",
+			"Milliseconds without a keepalive byte before the "
+			"device stops writing.",
+			"msecs",
+			"0"));
+  parser.addOption
+    (QCommandLineOption("port", "Port of the first device.", "port", "5000"));
+  parser.addOption
+    (QCommandLineOption("rate", "Bytes per second.", "bytes", "4096"));
+  parser.addOption(QCommandLineOption("stuck", "Write zeroes."));
+  parser.addOption
+    (QCommandLineOption("tls-certificate", "PEM certificate.", "file"));
+  parser.addOption(QCommandLineOption("tls-key", "PEM private key.", "file"));
+  parser.setApplicationDescription("Simulates TCP entropy devices.");
+  parser.process(application);
+
+  QSslCertificate certificate;
+  QSslKey key;
+
+  if(parser.isSet("tls-certificate") && parser.isSet("tls-key"))
+    {
+      QFile file;
+
+      file.setFileName(parser.value("tls-certificate"));
+
+      if(file.open(QIODevice::ReadOnly))
+	certificate = QSslCertificate(file.readAll());
+
+      file.close();
+      file.setFileName(parser.value("tls-key"));
+
+      auto const bytes(file.open(QIODevice::ReadOnly) ?
+		       file.readAll() : QByteArray());
+
+      key = QSslKey(bytes, QSsl::Rsa);
+
+      if(key.isNull())
+	key = QSslKey(bytes, QSsl::Ec);
+    }
+
+  QList<fortunate_q_simulated_device *> devices;
+  auto const port = parser.value("port").toInt();
+
+  for(int i = 0; i < qMax(1, parser.value("devices").toInt()); i++)
+    {
+      auto device = new fortunate_q_simulated_device(&application);
+
+      device->set_disconnect_interval
+	(parser.value("disconnect-interval").toInt());
+      device->set_keepalive_timeout(parser.value("keepalive-timeout").toInt());
+      device->set_rate
+	(parser.value("burst").toInt(), parser.value("rate").toInt());
+      device->set_stuck(parser.isSet("stuck"));
+      device->set_tls(certificate, key);
+
+      if(!device->listen(QHostAddress::LocalHost,
+			 static_cast<quint16> (port + i)))
+	{
+	  qCritical() << "Cannot listen on port" << port + i << ".";
+	  return EXIT_FAILURE;
+	}
+
+      devices << device;
+    }
+
+  QTimer timer;
+
+  QObject::connect(&timer,
+		   &QTimer::timeout,
+		   [&devices](void)
+		   {
+		     quint64 bytes = 0;
+		     quint64 connections = 0;
+		     quint64 dropped = 0;
+
+		     for(auto device : devices)
+		       {
+			 bytes += device->bytes_sent();
+			 connections += device->connections();
+			 dropped += device->dropped_bursts();
+		       }
+
+		     qInfo() << "Bytes:" << bytes
+			     << "Connections:" << connections
+			     << "Dropped bursts:" << dropped;
+		   });
+  timer.start(1000);
+  return application.exec();
+}
@@ -0,0 +1,311 @@
+/*
+** Copyright (c) 2023, Alexis Megas.
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from FortunateQ without specific prior written permission.
+**
+** FORTUNATEQ IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** FORTUNATEQ, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _fortunate_q_simulator_h_
+#define _fortunate_q_simulator_h_
+
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QRandomGenerator>
+#include <QSslCertificate>
+#include <QSslKey>
+#include <QSslSocket>
+#include <QTcpServer>
+#include <QTimer>
+
+/*
+** A loopback stand-in for a TCP entropy device. Data is written in bursts
+** at a configured rate. If a keepalive timeout is set, a connection
+** receives data only while the peer keeps sending bytes, as
+** fortunate_q::set_send_byte() does. Connections may be dropped
+** periodically to exercise reconnection.
+*/
+
+class fortunate_q_simulated_device: public QTcpServer
+{
+  Q_OBJECT
+
+ public:
+  fortunate_q_simulated_device(QObject *parent):QTcpServer(parent)
+  {
+    m_bucket = 4;
+    m_burst = 32;
+    m_bytes_released = 0;
+    m_bytes_sent = 0;
+    m_clock.start();
+    m_connections = 0;
+    m_disconnect_interval = 0;
+    m_generator.seed(QRandomGenerator::system()->generate());
+    m_keepalive_timeout = 0;
+    m_dropped_bursts = 0;
+    m_rate = 4096;
+    m_rate_start = 0;
+    m_stuck = false;
+    connect(&m_timer,
+	    &QTimer::timeout,
+	    this,
+	    &fortunate_q_simulated_device::slot_timeout);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    set_rate(m_burst, m_rate);
+  }
+
+  ~fortunate_q_simulated_device()
+  {
+    m_timer.stop();
+  }
+
+  quint64 bytes_sent(void) const
+  {
+    return m_bytes_sent;
+  }
+
+  quint64 connections(void) const
+  {
+    return m_connections;
+  }
+
+  quint64 dropped_bursts(void) const
+  {
+    /*
+    ** Bursts which a connection did not receive because its peer
+    ** did not keep up.
+    */
+
+    return m_dropped_bursts;
+  }
+
+  void set_disconnect_interval(const int interval)
+  {
+    /*
+    ** Zero keeps connections open.
+    */
+
+    m_disconnect_interval = qMax(0, interval);
+  }
+
+  void set_keepalive_timeout(const int timeout)
+  {
+    /*
+    ** Zero does not require keepalive bytes.
+    */
+
+    m_keepalive_timeout = qMax(0, timeout);
+  }
+
+  void set_rate(const int burst, const int rate)
+  {
+    /*
+    ** Bursts of burst bytes are written so that rate bytes are written
+    ** per second. A tick of the timer may write several bursts.
+    */
+
+    m_burst = qBound(1, burst, 1048576);
+    m_rate = qMax(1, rate);
+
+    auto const interval = qBound(static_cast<qint64> (1),
+				 static_cast<qint64> (m_burst) * 1000 / m_rate,
+				 static_cast<qint64> (60000));
+
+    /*
+    ** At most four ticks of bursts are owed after a stall.
+    */
+
+    m_bucket = 4 * (static_cast<quint64> (m_rate) *
+		    static_cast<quint64> (interval) / 1000 /
+		    static_cast<quint64> (m_burst) + 1);
+    m_bytes_released = 0;
+    m_rate_start = m_clock.nsecsElapsed();
+    m_timer.start(static_cast<int> (interval));
+  }
+
+  void set_stuck(const bool stuck)
+  {
+    /*
+    ** A stuck device writes zeroes.
+    */
+
+    m_stuck = stuck;
+  }
+
+  void set_tls(const QSslCertificate &certificate, const QSslKey &key)
+  {
+    m_certificate = certificate;
+    m_key = key;
+  }
+
+ protected:
+  void incomingConnection(qintptr socket_descriptor)
+  {
+    auto socket = new QSslSocket(this);
+
+    if(!socket->setSocketDescriptor(socket_descriptor))
+      {
+	socket->deleteLater();
+	return;
+      }
+
+    connect(socket,
+	    &QSslSocket::disconnected,
+	    socket,
+	    &QSslSocket::deleteLater);
+    connect(socket,
+	    &QSslSocket::readyRead,
+	    this,
+	    &fortunate_q_simulated_device::slot_ready_read);
+    m_connections += 1;
+
+    if(!m_certificate.isNull() && !m_key.isNull())
+      {
+	socket->setLocalCertificate(m_certificate);
+	socket->setPrivateKey(m_key);
+	socket->startServerEncryption();
+      }
+
+    m_sockets << socket;
+    socket->setProperty
+      ("connected", QVariant::fromValue<qint64> (m_clock.elapsed()));
+    socket->setProperty
+      ("keepalive", QVariant::fromValue<qint64> (m_clock.elapsed()));
+  }
+
+ private:
+  QElapsedTimer m_clock;
+  QList<QPointer<QSslSocket> > m_sockets;
+  QRandomGenerator m_generator;
+  QSslCertificate m_certificate;
+  QSslKey m_key;
+  QTimer m_timer;
+  bool m_stuck;
+  int m_burst;
+  int m_disconnect_interval;
+  int m_keepalive_timeout;
+  int m_rate;
+  qint64 m_rate_start;
+  quint64 m_bucket;
+  quint64 m_bytes_released;
+  quint64 m_bytes_sent;
+  quint64 m_connections;
+  quint64 m_dropped_bursts;
+
+  void write_burst(const QByteArray &data)
+  {
+    for(int i = m_sockets.size() - 1; i >= 0; i--)
+      {
+	auto socket = m_sockets.at(i);
+
+	if(!socket)
+	  {
+	    m_sockets.removeAt(i);
+	    continue;
+	  }
+
+	auto const now = m_clock.elapsed();
+
+	if(m_disconnect_interval > 0 &&
+	   now - socket->property("connected").toLongLong() >=
+	   m_disconnect_interval)
+	  {
+	    socket->disconnectFromHost();
+	    m_sockets.removeAt(i);
+	    continue;
+	  }
+
+	if(m_keepalive_timeout > 0 &&
+	   now - socket->property("keepalive").toLongLong() >
+	   m_keepalive_timeout)
+	  continue;
+
+	if(socket->state() != QAbstractSocket::ConnectedState ||
+	   (socket->isEncrypted() == false &&
+	    !m_certificate.isNull() &&
+	    !m_key.isNull()))
+	  continue;
+	else if(static_cast<quint64> (socket->bytesToWrite()) >=
+		m_bucket * static_cast<quint64> (m_burst))
+	  {
+	    m_dropped_bursts += 1;
+	    continue;
+	  }
+
+	auto const rc = socket->write(data);
+
+	if(rc > 0)
+	  m_bytes_sent += static_cast<quint64> (rc);
+      }
+  }
+
+ private slots:
+  void slot_ready_read(void)
+  {
+    auto socket = qobject_cast<QSslSocket *> (sender());
+
+    if(socket)
+      {
+	socket->readAll();
+	socket->setProperty
+	  ("keepalive", QVariant::fromValue<qint64> (m_clock.elapsed()));
+      }
+  }
+
+  void slot_timeout(void)
+  {
+    /*
+    ** A token bucket. The bytes owed are those which the rate allows
+    ** since set_rate() less those which were released.
+    */
+
+    auto const burst = static_cast<quint64> (m_burst);
+    auto const owed = static_cast<quint64>
+      (static_cast<double> (m_rate) *
+       static_cast<double> (m_clock.nsecsElapsed() - m_rate_start) / 1e9);
+
+    if(owed <= m_bytes_released)
+      return;
+
+    auto bursts = (owed - m_bytes_released) / burst;
+
+    if(bursts > m_bucket)
+      {
+	bursts = m_bucket;
+	m_bytes_released = owed - m_bucket * burst;
+      }
+
+    m_bytes_released += bursts * burst;
+
+    QByteArray data(m_burst, 0);
+
+    for(quint64 j = 0; j < bursts && !m_sockets.isEmpty(); j++)
+      {
+	if(!m_stuck)
+	  m_generator.generate(data.begin(), data.end());
+
+	write_burst(data);
+      }
+  }
+};
+
+#endif
@@ -0,0 +1,11 @@
+include(fortunate-q.pri)
+
+QMAKE_CLEAN	+= fortunate-q-simulator
+
+HEADERS	       += fortunate-q-simulator.h
+MOC_DIR         = Temporary/simulator/moc
+OBJECTS_DIR     = Temporary/simulator/obj
+PROJECTNAME     = fortunate-q-simulator
+RCC_DIR         = Temporary/simulator/rcc
+SOURCES	       += fortunate-q-simulator.cc
+TARGET		= fortunate-q-simulator
@@ -29,9 +29,171 @@
 
 #include <QCoreApplication>
 
+#ifdef Q_OS_UNIX
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#ifdef Q_OS_UNIX
+static bool fork_test(void)
+{
+  /*
+  ** A child's output must not follow from the parent's next output and
+  ** the child's identifier. The test mirrors a core which reseeded once
+  ** from pool 0 and served one request.
+  */
+
+  fortunate_q_core core;
+  uint8_t const header[2] = {0, 32};
+  uint8_t child[32];
+  uint8_t digest[sha256::DIGEST_SIZE];
+  uint8_t event[32];
+  uint8_t output[32];
+
+  memset(event, 1, sizeof(event));
+
+  if(!core.add_random_event(0, 0, event, sizeof(event)) ||
+     !core.random_data(output, sizeof(output)))
+    return false;
+
+  auto G(fortunate_q_core::initialize_generator());
+  sha256 pool;
+
+  pool.update(header, sizeof(header));
+  pool.update(event, sizeof(event));
+  pool.final(digest);
+  fortunate_q_core::reseed(digest, sizeof(digest), G);
+  fortunate_q_core::pseudo_random_data(output, sizeof(output), G);
+
+  int fds[2];
+
+  if(pipe(fds) != 0)
+    return false;
+
+  auto const pid = fork();
+
+  if(pid == 0)
+    {
+      auto const ok = core.random_data(output, sizeof(output)) &&
+	write(fds[1], output, sizeof(output)) ==
+	static_cast<ssize_t> (sizeof(output));
+
+      _exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+  close(fds[1]);
+
+  auto const rc = pid > 0 ? read(fds[0], child, sizeof(child)) : -1;
+
+  close(fds[0]);
+
+  if(pid > 0)
+    waitpid(pid, nullptr, 0);
+
+  if(rc != static_cast<ssize_t> (sizeof(child)))
+    return false;
+
+  /*
+  ** The parent's next 32 bytes, its next key, and the child's
+  ** identifier.
+  */
+
+  char identifier[32];
+  uint8_t s[32 + sizeof(identifier)];
+  auto const length = snprintf
+    (identifier, sizeof(identifier), "%lld", static_cast<long long> (pid));
+
+  if(length <= 0)
+    return false;
+
+  fortunate_q_core::pseudo_random_data(s, 32, G);
+  memcpy(s + 32, identifier, static_cast<size_t> (length));
+  fortunate_q_core::reseed(s, 32 + static_cast<size_t> (length), G);
+  fortunate_q_core::pseudo_random_data(output, sizeof(output), G);
+  return memcmp(child, output, sizeof(output)) != 0;
+}
+#endif
+
+static bool self_test(void)
+{
+  /*
+  ** Known answers from FIPS 180-4 and FIPS-197, Appendix C.3.
+  */
+
+  struct
+  {
+    QByteArray m_data;
+    const char *m_digest;
+  } const vectors[] =
+      {
+	{"",
+	 "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+	{"abc",
+	 "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+	{"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+	 "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+	{QByteArray(1000000, 'a'),
+	 "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"}
+      };
+  uint8_t digest[sha256::DIGEST_SIZE];
+
+  for(auto const &vector : vectors)
+    {
+      sha256 context;
+
+      /*
+      ** Uneven pieces exercise the buffering.
+      */
+
+      for(int i = 0; i < vector.m_data.size(); i += 37)
+	context.update
+	  (vector.m_data.constData() + i,
+	   static_cast<size_t>
+	   (qMin(37, static_cast<int> (vector.m_data.size()) - i)));
+
+      context.final(digest);
+
+      if(QByteArray(reinterpret_cast<const char *> (digest),
+		    static_cast<int> (sizeof(digest))) !=
+	 QByteArray::fromHex(vector.m_digest))
+	return false;
+    }
+
+  uint8_t block[16];
+  uint8_t key[32];
+
+  for(int i = 0; i < 32; i++)
+    key[i] = static_cast<uint8_t> (i);
+
+  for(int i = 0; i < 16; i++)
+    block[i] = static_cast<uint8_t> (17 * i);
+
+  aes256 aes(key);
+
+  aes.encrypt_block(block, block);
+  return QByteArray(reinterpret_cast<const char *> (block),
+		    static_cast<int> (sizeof(block))) ==
+    QByteArray::fromHex("8ea2b7ca516745bfeafc49904b496089");
+}
+
 int main(int argc, char *argv[])
 {
   QCoreApplication application(argc, argv);
+
+  if(!self_test())
+    {
+      qCritical() << "The SHA-256 or AES-256 self-test failed.";
+      return EXIT_FAILURE;
+    }
+
+#ifdef Q_OS_UNIX
+  if(!fork_test())
+    {
+      qCritical() << "The fork test failed.";
+      return EXIT_FAILURE;
+    }
+#endif
+
   fortunate_q_sample_class f;
 
   return application.exec();
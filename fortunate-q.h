@@ -28,62 +28,77 @@
 #ifndef _fortunate_q_h_
 #define _fortunate_q_h_
 
-#include "aes256.h"
+#include "fortunate-q-core.h"
 
-#include <QCryptographicHash>
+#include <QCoreApplication>
+#include <QDateTime>
 #include <QElapsedTimer>
 #include <QFile>
+#include <QFuture>
 #include <QHostAddress>
 #include <QPointer>
+#include <QSaveFile>
 #include <QSocketNotifier>
 #include <QSslSocket>
 #include <QTimer>
+#include <QVarLengthArray>
+#include <QtConcurrent>
 #include <QtDebug>
+#include <QtEndian>
 #include <QtMath>
 
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 10, 0))
-static qsizetype MIN_POOL_SIZE = 64;
-static qsizetype POOLS = 32;
-#else
-static int MIN_POOL_SIZE = 64;
-static int POOLS = 32;
-#endif
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <vector>
 
-class counter_q
+static const int HEALTH_TEST_WINDOW = 512;
+static const int HISTOGRAM_BUCKETS = 252;
+static const int SEED_FILE_SIZE = 64;
+static const int TRACE_HEADER_SIZE = 12;
+static const char TRACE_MAGIC[] = "FQTR2";
+
+struct fortunate_q_statistics
 {
- public:
-  counter_q(void)
-  {
-    m_l = m_r = 0;
-  }
+  /*
+  ** Latencies are in nanoseconds. Bucket i counts the values from
+  ** histogram_bucket(i) up to histogram_bucket(i + 1). Each power of two
+  ** is divided into four buckets.
+  */
 
-  QByteArray value(void) const
+  QVector<quint64> m_pool_bytes;
+  QVector<quint64> m_random_data_latency;
+  QVector<quint64> m_reseed_latency;
+  QVector<quint64> m_source_bytes;
+  qint64 m_since_last_reseed; // Milliseconds. Negative if never.
+  quint64 m_bytes_generated;
+  quint64 m_dropped_events;
+  quint64 m_reseeds;
+
+  static int histogram_index(const quint64 value)
   {
-    QByteArray value(16, 0);
+    if(value < 4)
+      return static_cast<int> (value);
 
-    memcpy(value.data(), &m_l, 8);
-    memcpy(value.data() + 8, &m_r, 8);
-    return value;
-  }
+    auto const msb = 63 - static_cast<int> (qCountLeadingZeroBits(value));
 
-  bool is_zero(void) const
-  {
-    return m_l == 0 && m_r == 0;
+    return (msb - 1) * 4 + static_cast<int> ((value >> (msb - 2)) & 3);
   }
 
-  void increment(void)
+  static quint64 histogram_bucket(const int i)
   {
-    m_r += 1;
+    if(i < 4)
+      return static_cast<quint64> (qMax(0, i));
+    else if(i >= HISTOGRAM_BUCKETS)
+      return std::numeric_limits<quint64>::max();
 
-    if(m_r == 0)
-      m_l += 1;
+    return static_cast<quint64> (4 + i % 4) << (i / 4 - 1);
   }
-
- private:
-  quint64 m_l;
-  quint64 m_r;
 };
 
+Q_DECLARE_METATYPE(fortunate_q_statistics)
+
 class fortunate_q: public QObject
 {
   Q_OBJECT
@@ -91,20 +106,197 @@ class fortunate_q: public QObject
  public:
   fortunate_q(QObject *parent):QObject(parent)
   {
-    m_R = initialize_prng();
-    m_source_indices.resize(POOLS);
+    m_source_indices.resize(static_cast<int> (fortunate_q_core::POOLS));
+    m_condensing.resize(m_source_indices.size());
+    m_health.resize(m_source_indices.size());
+    m_replay_speed = 0.0;
+    m_seeded = false;
+    m_replay_timer.setSingleShot(true);
+    set_health_tests(1.0, 10000);
+    m_statistics.m_bytes_generated.store(0, std::memory_order_relaxed);
+    m_statistics.m_dropped_events.store(0, std::memory_order_relaxed);
+    m_statistics.m_last_reseed.store(-1, std::memory_order_relaxed);
+    m_statistics.m_pool_bytes = std::vector<std::atomic<quint64> >
+      (fortunate_q_core::POOLS);
+    m_statistics.m_random_data_latency = std::vector<std::atomic<quint64> >
+      (HISTOGRAM_BUCKETS);
+    m_statistics.m_reseed_latency = std::vector<std::atomic<quint64> >
+      (HISTOGRAM_BUCKETS);
+    m_statistics.m_reseeds.store(0, std::memory_order_relaxed);
+    m_statistics.m_source_bytes = std::vector<std::atomic<quint64> >
+      (static_cast<size_t> (m_source_indices.size()));
+    qRegisterMetaType<fortunate_q_statistics> ("fortunate_q_statistics");
     m_tcp_socket_connection_timer.setInterval(500);
   }
 
   ~fortunate_q()
   {
     m_periodic_write_timer.stop();
+    m_replay_timer.stop();
+    m_seed_file_timer.stop();
+    m_statistics_timer.stop();
     m_tcp_socket_connection_timer.stop();
+    write_seed_file();
+  }
+
+  bool is_seeded(void)
+  {
+    /*
+    ** Whether a seed file was read or pool 0 has collected enough for
+    ** the first reseed. Until then, the output depends on the initial
+    ** key alone.
+    */
+
+    m_seeded = m_seeded ||
+      m_core.pool_size(0) >= fortunate_q_core::MIN_POOL_SIZE;
+    return m_seeded;
   }
 
   QByteArray random_data(const int n)
   {
-    return random_data(n, m_R);
+    QByteArray r(qBound(0, n, 1048576), 0);
+
+    if(!random_data(r.data(), n))
+      r.clear();
+
+    return r;
+  }
+
+  bool random_data(char *data, const int n)
+  {
+    return random_data_batch(&data, &n, 1);
+  }
+
+  bool random_data_batch(char *const *outputs,
+			 const int *sizes,
+			 const int count)
+  {
+    /*
+    ** Serves count requests with one reseed check. Request i is written
+    ** into outputs[i]. The generator is rekeyed between requests.
+    */
+
+    if(count < 0 || !outputs || !sizes)
+      return false;
+
+    QVarLengthArray<size_t, 64> n(count);
+    QVarLengthArray<uint8_t *, 64> o(count);
+    quint64 total = 0;
+
+    for(int i = 0; i < count; i++)
+      {
+	if(sizes[i] < 0)
+	  return false;
+
+	n[i] = static_cast<size_t> (sizes[i]);
+	o[i] = reinterpret_cast<uint8_t *> (outputs[i]);
+	total += n[i];
+      }
+
+    QElapsedTimer timer;
+
+    timer.start();
+    m_core.rekey_if_forked();
+
+    auto const start = timer.nsecsElapsed();
+
+    if(m_core.reseed_if_necessary())
+      {
+	increment
+	  (m_statistics.m_reseed_latency
+	   [static_cast<size_t> (fortunate_q_statistics::histogram_index
+				 (static_cast<quint64> (timer.nsecsElapsed() -
+							start)))]);
+	increment(m_statistics.m_reseeds);
+	m_statistics.m_last_reseed.store
+	  (timer.msecsSinceReference(), std::memory_order_relaxed);
+
+	for(size_t i = 0; i < fortunate_q_core::POOLS; i++)
+	  m_statistics.m_pool_bytes[i].store
+	    (m_core.pool_size(i), std::memory_order_relaxed);
+      }
+
+    auto const ok = m_core.generate_batch
+      (o.constData(), n.constData(), static_cast<size_t> (count));
+
+    if(ok)
+      increment(m_statistics.m_bytes_generated, total);
+
+    increment
+      (m_statistics.m_random_data_latency
+       [static_cast<size_t> (fortunate_q_statistics::histogram_index
+			     (static_cast<quint64> (timer.nsecsElapsed())))]);
+    return ok;
+  }
+
+  QFuture<QByteArray> random_data_async(const int n)
+  {
+    /*
+    ** The worker receives its own generator, keyed from this one.
+    ** Neither the pools nor this generator are shared with the worker,
+    ** and requests larger than 1 MiB are rekeyed every 1 MiB.
+    */
+
+    auto G(fortunate_q_core::initialize_generator());
+
+    if(n < 0 ||
+       !random_data(reinterpret_cast<char *> (G.m_key.data()),
+		    static_cast<int> (G.m_key.size())))
+      return QtConcurrent::run([](void) {return QByteArray();});
+
+    G.m_counter.increment();
+    return QtConcurrent::run([G, n](void) mutable
+			     {
+			       QByteArray r(n, 0);
+
+			       for(int i = 0; i < n; i += 1048576)
+				 if(!fortunate_q_core::pseudo_random_data
+				    (reinterpret_cast<uint8_t *> (r.data()) + i,
+				     static_cast<size_t> (qMin(1048576, n - i)),
+				     G))
+				   return QByteArray();
+
+			       return r;
+			     });
+  }
+
+  fortunate_q_statistics statistics(void) const
+  {
+    /*
+    ** May be called from any thread.
+    */
+
+    QElapsedTimer timer;
+    auto const last = m_statistics.m_last_reseed.load
+      (std::memory_order_relaxed);
+    fortunate_q_statistics statistics;
+
+    timer.start();
+    statistics.m_bytes_generated = m_statistics.m_bytes_generated.load
+      (std::memory_order_relaxed);
+    statistics.m_dropped_events = m_statistics.m_dropped_events.load
+      (std::memory_order_relaxed);
+    statistics.m_pool_bytes = snapshot(m_statistics.m_pool_bytes);
+    statistics.m_random_data_latency = snapshot
+      (m_statistics.m_random_data_latency);
+    statistics.m_reseed_latency = snapshot(m_statistics.m_reseed_latency);
+    statistics.m_reseeds = m_statistics.m_reseeds.load
+      (std::memory_order_relaxed);
+    statistics.m_since_last_reseed = last < 0 ?
+      -1 : timer.msecsSinceReference() - last;
+    statistics.m_source_bytes = snapshot(m_statistics.m_source_bytes);
+    return statistics;
+  }
+
+  void set_condensing(const int source, const bool state)
+  {
+    /*
+    ** Each burst from source is condensed into one SHA-256 digest
+    ** before it reaches a pool. A trace records the digests.
+    */
+
+    if(source >= 0 && source < m_condensing.size())
+      m_condensing[source] = state;
   }
 
   void set_file_peer(const QString &file_name)
@@ -125,6 +317,89 @@ class fortunate_q: public QObject
 	    SLOT(slot_file_ready_read(void)));
   }
 
+  void set_health_tests(const double min_entropy, const int quarantine)
+  {
+    /*
+    ** SP 800-90B Repetition Count and Adaptive Proportion tests with a
+    ** false-positive probability of 2^-20. The assessed min-entropy is
+    ** per byte. A failing source is ignored for quarantine milliseconds.
+    ** A min-entropy of zero disables the tests.
+    */
+
+    auto const h = qBound(0.0, min_entropy, 8.0);
+
+    if(h > 0.0)
+      {
+	m_health_apt_cutoff = binomial_cutoff
+	  (HEALTH_TEST_WINDOW, std::pow(2.0, -h), std::pow(2.0, -20.0));
+	m_health_rct_cutoff = 1 + static_cast<int> (std::ceil(20.0 / h));
+      }
+    else
+      {
+	m_health_apt_cutoff = 0;
+	m_health_rct_cutoff = 0;
+      }
+
+    m_health_quarantine = qMax(0, quarantine);
+
+    for(int i = 0; i < m_health.size(); i++)
+      m_health[i] = health_state();
+  }
+
+  void set_replay_file(const QString &file_name, const double speed)
+  {
+    /*
+    ** Feeds a trace which set_trace_file() recorded. The events reach
+    ** the same pools in the same order. A speed of 2.0 replays twice as
+    ** fast as the original. A speed of zero replays without delays.
+    ** The health tests are not repeated. Each event is accepted or
+    ** dropped as it was during the recording. replay_finished() reports
+    ** whether the trace was read to its end without error.
+    */
+
+    m_replay_event = replay_event();
+    m_replay_file.close();
+    m_replay_timer.stop();
+
+    if(file_name.trimmed().isEmpty())
+      return;
+
+    m_replay_file.setFileName(file_name.trimmed());
+
+    if(!m_replay_file.open(QIODevice::ReadOnly))
+      return;
+
+    if(m_replay_file.read(sizeof(TRACE_MAGIC) - 1) != TRACE_MAGIC)
+      {
+	m_replay_file.close();
+	return;
+      }
+
+    connect(&m_replay_timer,
+	    &QTimer::timeout,
+	    this,
+	    &fortunate_q::slot_replay,
+	    Qt::UniqueConnection);
+
+    for(int i = 0; i < m_health.size(); i++)
+      m_health[i] = health_state();
+
+    m_replay_clock.start();
+    m_replay_speed = qMax(0.0, speed);
+    m_replay_timer.start(0);
+  }
+
+  void set_reseed_policy(const fortunate_q_reseed_policy &policy)
+  {
+    /*
+    ** For example, a fast source may fill pool 0 before every request.
+    ** A minimum interval or a limit of reseeds per second then bounds
+    ** the cost of reseeding.
+    */
+
+    m_core.reseed_policy() = policy;
+  }
+
   void set_send_byte(const char byte, const int interval)
   {
     /*
@@ -143,6 +418,75 @@ class fortunate_q: public QObject
     m_send_byte[0] = byte;
   }
 
+  void set_seed_file(const QString &file_name, const int interval)
+  {
+    /*
+    ** Fortuna's seed file. The seed is mixed into the generator and
+    ** replaced at once so that it is never used twice. A missing file
+    ** is created. The file is rewritten every interval milliseconds
+    ** and when this object is destroyed.
+    */
+
+    if(file_name.trimmed().isEmpty())
+      return;
+
+    m_seed_file_name = file_name.trimmed();
+    update_seed_file();
+
+    if(interval > 0)
+      {
+	connect(&m_seed_file_timer,
+		&QTimer::timeout,
+		this,
+		&fortunate_q::slot_write_seed_file,
+		Qt::UniqueConnection);
+	m_seed_file_timer.start(interval);
+      }
+    else
+      m_seed_file_timer.stop();
+  }
+
+  void set_trace_file(const QString &file_name)
+  {
+    /*
+    ** Records every event which the sources deliver. An empty name
+    ** ends the recording.
+    */
+
+    m_trace_file.close();
+
+    if(file_name.trimmed().isEmpty())
+      return;
+
+    m_trace_file.setFileName(file_name.trimmed());
+
+    if(m_trace_file.open(QIODevice::Truncate | QIODevice::WriteOnly))
+      {
+	m_trace_file.write(TRACE_MAGIC, sizeof(TRACE_MAGIC) - 1);
+	m_trace_timer.start();
+      }
+  }
+
+  void set_statistics_interval(const int interval)
+  {
+    /*
+    ** statistics_updated() is emitted every interval milliseconds.
+    */
+
+    if(interval <= 0)
+      {
+	m_statistics_timer.stop();
+	return;
+      }
+
+    connect(&m_statistics_timer,
+	    &QTimer::timeout,
+	    this,
+	    &fortunate_q::slot_emit_statistics,
+	    Qt::UniqueConnection);
+    m_statistics_timer.start(interval);
+  }
+
   void set_tcp_peer(const QString &address, const bool tls, const quint16 port)
   {
     if(address.trimmed().isEmpty())
@@ -187,154 +531,463 @@ class fortunate_q: public QObject
     TCP = 1
   };
 
-  struct generator_state
+  struct health_state
   {
-    QByteArray m_key;
-    counter_q m_counter;
+    QElapsedTimer m_quarantine;
+    int m_apt_count = 0;
+    int m_apt_samples = 0;
+    int m_rct_count = 0;
+    char m_apt_value = 0;
+    char m_rct_value = 0;
   };
 
-  struct prng_state
+  struct replay_event
   {
-    QElapsedTimer m_lastReseed;
-    QVector<QByteArray> m_P;
-    generator_state m_G;
-#ifndef __SIZEOF_INT128__
-    quint64 m_reseedCnt;
-#else
-    unsigned __int128 m_reseedCnt;
-#endif
+    QByteArray m_data;
+    bool m_accepted = false;
+    bool m_valid = false;
+    int m_pool = 0;
+    int m_source = 0;
+    qint64 m_time = 0;
   };
 
+  struct statistics_state
+  {
+    std::atomic<qint64> m_last_reseed;
+    std::atomic<quint64> m_bytes_generated;
+    std::atomic<quint64> m_dropped_events;
+    std::atomic<quint64> m_reseeds;
+    std::vector<std::atomic<quint64> > m_pool_bytes;
+    std::vector<std::atomic<quint64> > m_random_data_latency;
+    std::vector<std::atomic<quint64> > m_reseed_latency;
+    std::vector<std::atomic<quint64> > m_source_bytes;
+  };
+
+  QElapsedTimer m_replay_clock;
+  QElapsedTimer m_trace_timer;
   QFile m_file;
+  QFile m_replay_file;
+  QFile m_trace_file;
   QPointer<QSocketNotifier> m_file_notifier;
   QSslSocket m_tcp_socket;
+  QString m_seed_file_name;
   QString m_tcp_address;
   QTimer m_periodic_write_timer;
+  QTimer m_replay_timer;
+  QTimer m_seed_file_timer;
+  QTimer m_statistics_timer;
   QTimer m_tcp_socket_connection_timer;
+  QVector<bool> m_condensing;
+  QVector<health_state> m_health;
   QVector<int> m_source_indices;
+  bool m_seeded;
   bool m_tcp_socket_tls;
   char m_send_byte[1];
-  prng_state m_R; // The magic pseudo-random number generator.
+  double m_replay_speed;
+  fortunate_q_core m_core; // The magic pseudo-random number generator.
+  int m_health_apt_cutoff;
+  int m_health_quarantine;
+  int m_health_rct_cutoff;
   quint16 m_tcp_port;
+  replay_event m_replay_event;
+  statistics_state m_statistics;
 
-  static QByteArray E(const QByteArray &C, const QByteArray &K)
+  static int binomial_cutoff(const int n, const double p, const double alpha)
   {
-    aes256 aes(K.constData());
-    auto const string(std::string(C.toHex().constData()));
+    /*
+    ** The smallest c such that P(X >= c) <= alpha, X ~ B(n, p).
+    */
 
-    return QByteArray::fromHex
-      (aes256::to_hex(aes.encrypt_block(aes256::from_hex(string))).data());
+    auto tail = 1.0;
+
+    for(int k = 0; k <= n; k++)
+      {
+	if(tail <= alpha)
+	  return k;
+
+	tail -= std::exp(std::lgamma(n + 1.0) -
+			 std::lgamma(k + 1.0) -
+			 std::lgamma(n - k + 1.0) +
+			 k * std::log(p) +
+			 (n - k) * std::log1p(-p));
+      }
+
+    return n + 1;
   }
 
-  static QByteArray generate_blocks(const int k, generator_state &G)
+  static QVector<quint64> snapshot
+    (const std::vector<std::atomic<quint64> > &vector)
   {
-    QByteArray r;
+    QVector<quint64> snapshot(static_cast<int> (vector.size()));
 
-    if(!G.m_counter.is_zero())
-      for(int i = 1; i <= k; i++)
-	{
-	  r = r + E(G.m_counter.value(), G.m_key);
-	  G.m_counter.increment();
-	}
+    for(int i = 0; i < snapshot.size(); i++)
+      snapshot[i] = vector[static_cast<size_t> (i)].load
+	(std::memory_order_relaxed);
 
-    return r;
+    return snapshot;
   }
 
-  static QByteArray pseudo_random_data(const int n, generator_state &G)
+  static void increment(std::atomic<quint64> &counter, const quint64 n = 1)
   {
-    QByteArray r;
+    /*
+    ** The owning thread is the only writer. A plain load and store
+    ** avoids a locked instruction.
+    */
+
+    counter.store
+      (counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  void add_event(const int i,
+		 const int s,
+		 const QByteArray &e,
+		 const quint64 bytes)
+  {
+    /*
+    ** e represents bytes bytes of source data.
+    */
 
-    if(0 <= n && 1048576 >= n)
+    if(i < 0 || i >= static_cast<int> (fortunate_q_core::POOLS))
       {
-	r = generate_blocks(qCeil(n / 16.0), G).mid(0, n);
-	G.m_key = generate_blocks(2, G);
+	increment(m_statistics.m_dropped_events);
+	return;
       }
 
-    return r;
+    auto const size = m_core.pool_size(static_cast<size_t> (i));
+
+    if(!m_core.add_random_event(static_cast<size_t> (i),
+				s,
+				reinterpret_cast<const uint8_t *>
+				(e.constData()),
+				static_cast<size_t> (e.size())))
+      {
+	increment(m_statistics.m_dropped_events);
+	return;
+      }
+
+    increment(m_statistics.m_pool_bytes[static_cast<size_t> (i)],
+	      m_core.pool_size(static_cast<size_t> (i)) - size);
+
+    if(s >= 0 && s < static_cast<int> (m_statistics.m_source_bytes.size()))
+      increment(m_statistics.m_source_bytes[static_cast<size_t> (s)], bytes);
+
+    emit pool_filled(i, s);
   }
 
-  static QByteArray random_data(const int n, prng_state &R)
+  bool add_random_event(const int i, const int s, const QByteArray &e)
   {
-    if(MIN_POOL_SIZE <= R.m_P.value(0).size() ||
-       R.m_lastReseed.elapsed() > 100 ||
-       R.m_lastReseed.isValid() == false)
+    /*
+    ** Returns false if e was dropped.
+    */
+
+    if(e.isEmpty())
+      return false;
+    else if(i < 0 ||
+	    i >= static_cast<int> (fortunate_q_core::POOLS) ||
+	    !health_test(s, e))
+      {
+	increment(m_statistics.m_dropped_events);
+	return false;
+      }
+
+    add_event(i, s, e, static_cast<quint64> (e.size()));
+    return true;
+  }
+
+  bool health_test(const int s, const QByteArray &e)
+  {
+    if(s < 0 || s >= m_health.size() || m_health_rct_cutoff <= 0)
+      return true;
+
+    auto &health(m_health[s]);
+
+    if(health.m_quarantine.isValid())
       {
-	QByteArray s;
+	if(health.m_quarantine.elapsed() < m_health_quarantine)
+	  return false;
 
-	R.m_reseedCnt += 1;
+	health = health_state();
+      }
 
-	for(int i = 0; i < static_cast<int> (R.m_P.size()); i++)
-	  if(R.m_reseedCnt % static_cast<quint64> (qPow(2.0, i)) == 0)
-	    {
-	      s = s + QCryptographicHash::hash
-		(R.m_P[i], QCryptographicHash::Sha256);
-	      R.m_P[i].clear();
-	    }
+    /*
+    ** Proportions are counted with std::count(), which the compiler
+    ** vectorizes. The early exit of std::find_if() prevents that, but
+    ** the runs of a healthy source are short.
+    */
 
-	reseed(s, R.m_G);
-	R.m_lastReseed.start();
+    auto const begin = e.constData();
+    auto const end = begin + e.size();
+    auto failed = false;
+
+    for(auto p = begin; p < end && !failed;)
+      {
+	auto const v = health.m_rct_value;
+	auto const q = std::find_if
+	  (p, end, [v](const char c) {return c != v;});
+
+	health.m_rct_count += static_cast<int> (q - p);
+	failed = health.m_rct_count >= m_health_rct_cutoff;
+
+	if(q < end)
+	  {
+	    health.m_rct_count = 0;
+	    health.m_rct_value = *q;
+	  }
+
+	p = q;
+      }
+
+    for(auto p = begin; p < end && !failed;)
+      {
+	if(health.m_apt_samples == 0)
+	  {
+	    health.m_apt_count = 1;
+	    health.m_apt_samples = 1;
+	    health.m_apt_value = *p++;
+	    continue;
+	  }
+
+	auto const n = qMin
+	  (static_cast<int> (end - p),
+	   HEALTH_TEST_WINDOW - health.m_apt_samples);
+
+	health.m_apt_count += static_cast<int>
+	  (std::count(p, p + n, health.m_apt_value));
+	health.m_apt_samples += n;
+	failed = health.m_apt_count >= m_health_apt_cutoff;
+	p += n;
+
+	if(health.m_apt_samples >= HEALTH_TEST_WINDOW)
+	  health.m_apt_samples = 0;
+      }
+
+    if(failed)
+      {
+	health.m_quarantine.start();
+	emit source_quarantined(s);
+	return false;
       }
 
-    if(R.m_reseedCnt == 0)
-      return QByteArray(); // Error!
+    return true;
+  }
+
+  void process_device(QIODevice *device, const int i, const int s)
+  {
+    if(!device || !device->isOpen())
+      return;
+    else if(s >= 0 && s < m_condensing.size() && m_condensing.at(s))
+      {
+	/*
+	** The burst is health-tested as it is read and is condensed into
+	** one digest. A fast source then costs the pools and the reseeds
+	** as much as a slow one.
+	*/
+
+	QByteArray digest(static_cast<int> (sha256::DIGEST_SIZE), 0);
+	quint64 bytes = 0;
+	sha256 context;
+
+	do
+	  {
+	    auto e(device->read(4096));
+
+	    if(e.isEmpty())
+	      break;
+	    else if(health_test(s, e))
+	      {
+		bytes += static_cast<quint64> (e.size());
+		context.update(e.constData(), static_cast<size_t> (e.size()));
+	      }
+	    else
+	      increment(m_statistics.m_dropped_events);
+
+	    e.fill(0);
+	  }
+	while(device->bytesAvailable() > 0);
+
+	if(bytes == 0)
+	  return;
+
+	context.final(reinterpret_cast<uint8_t *> (digest.data()));
+	trace_event(i, s, digest, true);
+	add_event(i, s, digest, bytes);
+	digest.fill(0);
+      }
     else
-      return pseudo_random_data(n, R.m_G);
+      do
+	{
+	  auto const e(device->read(32));
+
+	  trace_event(i, s, e, add_random_event(i, s, e));
+	}
+      while(device->bytesAvailable() > 0);
   }
 
-  static generator_state initialize_generator(void)
+  void read_seed_file(QFile &file)
   {
+    auto const data = file.map(0, SEED_FILE_SIZE);
+
+    if(!data)
+      return;
+
     /*
-    ** What is a zero key?
+    ** Processes which start together may read the same seed. The
+    ** process identifier and the time keep their generators apart.
     */
 
-    return generator_state{QByteArray(32, '0'), counter_q()};
+    auto const s
+      (QByteArray::fromRawData(reinterpret_cast<const char *> (data),
+			       SEED_FILE_SIZE) +
+       QByteArray::number(QCoreApplication::applicationPid()) +
+       QByteArray::number(QDateTime::currentMSecsSinceEpoch()));
+
+    m_core.reseed(reinterpret_cast<const uint8_t *> (s.constData()),
+		  static_cast<size_t> (s.size()));
+    m_seeded = true;
+    file.unmap(data);
   }
 
-  static prng_state initialize_prng(void)
+  void trace_event(const int i,
+		   const int s,
+		   const QByteArray &e,
+		   const bool accepted)
   {
-    prng_state R;
+    if(!m_trace_file.isOpen() || e.isEmpty())
+      return;
+
+    /*
+    ** Nanoseconds since the recording began (8 bytes, little endian),
+    ** the source, the pool, the length, whether the health tests
+    ** accepted the event, and the data.
+    */
 
-    R.m_G = initialize_generator();
-    R.m_P.resize(POOLS);
-    R.m_reseedCnt = 0;
-    return R;
+    char header[TRACE_HEADER_SIZE];
+    auto const t = qToLittleEndian
+      (static_cast<qint64> (m_trace_timer.nsecsElapsed()));
+
+    memcpy(header, &t, sizeof(t));
+    header[8] = static_cast<char> (s);
+    header[9] = static_cast<char> (i);
+    header[10] = static_cast<char> (e.size());
+    header[11] = accepted ? 1 : 0;
+    m_trace_file.write(header, TRACE_HEADER_SIZE);
+    m_trace_file.write(e);
   }
 
-  static void reseed(const QByteArray &s, generator_state &G)
+  void update_seed_file(void)
   {
-    G.m_counter.increment();
-    G.m_key = QCryptographicHash::hash
-      (G.m_key + s, QCryptographicHash::Sha256);
+    QFile file(m_seed_file_name);
+
+    if(file.open(QIODevice::ReadOnly) && file.size() == SEED_FILE_SIZE)
+      read_seed_file(file);
+
+    file.close();
+    write_seed_file();
   }
 
-  void process_device(QIODevice *device, const int i, const int s)
+  void write_seed_file(void)
   {
-    if(device && device->isOpen())
-      do
-	{
-	  auto const e(device->read(32));
+    /*
+    ** A seed which the initial key alone determines is not written.
+    */
 
-	  if(!e.isEmpty() && i < m_R.m_P.size())
-	    {
-	      m_R.m_P[i] = m_R.m_P[i] +
-		QByteArray::number(s) +
-		QByteArray::number(e.size()) +
-		e;
-	      emit pool_filled(i, s);
-	    }
-	}
-      while(device->bytesAvailable() > 0);
+    if(m_seed_file_name.isEmpty() || !is_seeded())
+      return;
+
+    auto const seed(random_data(SEED_FILE_SIZE));
+
+    if(seed.size() != SEED_FILE_SIZE)
+      return;
+
+    QSaveFile file(m_seed_file_name);
+
+    if(file.open(QIODevice::WriteOnly))
+      {
+	file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+	file.write(seed);
+	file.commit();
+      }
   }
 
  private slots:
+  void slot_emit_statistics(void)
+  {
+    emit statistics_updated(statistics());
+  }
+
   void slot_file_ready_read(void)
   {
     auto const s = static_cast<int> (Devices::FILE);
 
-    m_source_indices[s] = (m_source_indices[s] + 1) % POOLS;
+    m_source_indices[s] = (m_source_indices[s] + 1) %
+      static_cast<int> (fortunate_q_core::POOLS);
     process_device(&m_file, m_source_indices[s], s);
   }
 
+  void slot_replay(void)
+  {
+    for(int i = 0; i < 1024; i++)
+      {
+	if(!m_replay_event.m_valid)
+	  {
+	    char header[TRACE_HEADER_SIZE];
+	    auto const rc = m_replay_file.read(header, TRACE_HEADER_SIZE);
+
+	    if(rc != TRACE_HEADER_SIZE)
+	      {
+		m_replay_file.close();
+		emit replay_finished(rc == 0);
+		return;
+	      }
+
+	    auto const size = static_cast<quint8> (header[10]);
+	    qint64 t = 0;
+
+	    memcpy(&t, header, sizeof(t));
+	    m_replay_event.m_data = m_replay_file.read(size);
+
+	    if(m_replay_event.m_data.size() != size)
+	      {
+		m_replay_event = replay_event();
+		m_replay_file.close();
+		emit replay_finished(false);
+		return;
+	      }
+
+	    m_replay_event.m_accepted = header[11] != 0;
+	    m_replay_event.m_pool = static_cast<quint8> (header[9]);
+	    m_replay_event.m_source = static_cast<quint8> (header[8]);
+	    m_replay_event.m_time = qFromLittleEndian(t);
+	    m_replay_event.m_valid = true;
+	  }
+
+	if(m_replay_speed > 0.0)
+	  {
+	    auto const due = static_cast<qint64>
+	      (static_cast<double> (m_replay_event.m_time) / m_replay_speed);
+	    auto const now = m_replay_clock.nsecsElapsed();
+
+	    if(due > now)
+	      {
+		m_replay_timer.start(static_cast<int> ((due - now) / 1000000));
+		return;
+	      }
+	  }
+
+	if(m_replay_event.m_accepted)
+	  add_event(m_replay_event.m_pool,
+		    m_replay_event.m_source,
+		    m_replay_event.m_data,
+		    static_cast<quint64> (m_replay_event.m_data.size()));
+	else
+	  increment(m_statistics.m_dropped_events);
+
+	m_replay_event = replay_event();
+      }
+
+    m_replay_timer.start(0);
+  }
+
   void slot_send_byte(void)
   {
     if(m_tcp_socket.state() == QAbstractSocket::ConnectedState)
@@ -368,7 +1021,8 @@ class fortunate_q: public QObject
   {
     auto const s = static_cast<int> (Devices::TCP);
 
-    m_source_indices[s] = (m_source_indices[s] + 1) % POOLS;
+    m_source_indices[s] = (m_source_indices[s] + 1) %
+      static_cast<int> (fortunate_q_core::POOLS);
     process_device(&m_tcp_socket, m_source_indices[s], s);
   }
 
@@ -378,8 +1032,16 @@ class fortunate_q: public QObject
     m_tcp_socket.ignoreSslErrors();
   }
 
+  void slot_write_seed_file(void)
+  {
+    write_seed_file();
+  }
+
  signals:
   void pool_filled(const int index, const int source);
+  void replay_finished(const bool complete);
+  void source_quarantined(const int source);
+  void statistics_updated(const fortunate_q_statistics &statistics);
 };
 
 #endif
@@ -0,0 +1,257 @@
+/*
+** Copyright (c) Alexis Megas.
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from sha256 without specific prior written permission.
+**
+** SHA256 IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** SHA256, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <cstdint>
+#include <cstring>
+
+static const uint32_t s_sha256_k[64] =
+{
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+  0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+  0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+  0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+  0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+  0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/*
+** FIPS 180-4 SHA-256. The state has a fixed size and nothing is
+** allocated, so a context may be updated incrementally for as long as
+** its owner wishes.
+*/
+
+class sha256
+{
+ public:
+  static constexpr size_t DIGEST_SIZE = 32;
+
+  sha256(void)
+  {
+    reset();
+  }
+
+  ~sha256()
+  {
+    clear();
+  }
+
+  static void hash(const void *data, const size_t size, uint8_t *digest)
+  {
+    sha256 context;
+
+    context.update(data, size);
+    context.final(digest);
+  }
+
+  uint64_t size(void) const
+  {
+    return m_size;
+  }
+
+  void clear(void)
+  {
+    /*
+    ** Erases the state before resetting it.
+    */
+
+    volatile uint8_t *b = m_block;
+
+    for(size_t i = 0; i < sizeof(m_block); i++)
+      b[i] = 0;
+
+    volatile uint32_t *h = m_h;
+
+    for(size_t i = 0; i < 8; i++)
+      h[i] = 0;
+
+    reset();
+  }
+
+  void final(uint8_t *digest)
+  {
+    auto const bits = m_size * 8;
+    uint8_t length[8];
+    uint8_t pad = 0x80;
+
+    for(size_t i = 0; i < 8; i++)
+      length[i] = static_cast<uint8_t> (bits >> (56 - 8 * i));
+
+    update(&pad, 1);
+    pad = 0;
+
+    while(m_used != 56)
+      update(&pad, 1);
+
+    update(length, sizeof(length));
+
+    for(size_t i = 0; i < 8; i++)
+      {
+	digest[4 * i + 0] = static_cast<uint8_t> (m_h[i] >> 24);
+	digest[4 * i + 1] = static_cast<uint8_t> (m_h[i] >> 16);
+	digest[4 * i + 2] = static_cast<uint8_t> (m_h[i] >> 8);
+	digest[4 * i + 3] = static_cast<uint8_t> (m_h[i]);
+      }
+
+    clear();
+  }
+
+  void update(const void *data, size_t size)
+  {
+    auto p = static_cast<const uint8_t *> (data);
+
+    if(!p)
+      return;
+
+    m_size += size;
+
+    if(m_used > 0)
+      {
+	auto const n = size < 64 - m_used ? size : 64 - m_used;
+
+	memcpy(m_block + m_used, p, n);
+	m_used += n;
+	p += n;
+	size -= n;
+
+	if(m_used < 64)
+	  return;
+
+	compress(m_block);
+	m_used = 0;
+      }
+
+    while(size >= 64)
+      {
+	compress(p);
+	p += 64;
+	size -= 64;
+      }
+
+    if(size > 0)
+      {
+	memcpy(m_block, p, size);
+	m_used = size;
+      }
+  }
+
+ private:
+  size_t m_used;
+  uint32_t m_h[8];
+  uint64_t m_size;
+  uint8_t m_block[64];
+
+  static uint32_t rotr(const uint32_t x, const int n)
+  {
+    return (x >> n) | (x << (32 - n));
+  }
+
+  void compress(const uint8_t *block)
+  {
+    uint32_t w[64];
+
+    for(size_t i = 0; i < 16; i++)
+      w[i] = static_cast<uint32_t> (block[4 * i + 0]) << 24 |
+	static_cast<uint32_t> (block[4 * i + 1]) << 16 |
+	static_cast<uint32_t> (block[4 * i + 2]) << 8 |
+	static_cast<uint32_t> (block[4 * i + 3]);
+
+    for(size_t i = 16; i < 64; i++)
+      {
+	auto const s0 = rotr(w[i - 15], 7) ^
+	  rotr(w[i - 15], 18) ^
+	  (w[i - 15] >> 3);
+	auto const s1 = rotr(w[i - 2], 17) ^
+	  rotr(w[i - 2], 19) ^
+	  (w[i - 2] >> 10);
+
+	w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+      }
+
+    auto a = m_h[0];
+    auto b = m_h[1];
+    auto c = m_h[2];
+    auto d = m_h[3];
+    auto e = m_h[4];
+    auto f = m_h[5];
+    auto g = m_h[6];
+    auto h = m_h[7];
+
+    for(size_t i = 0; i < 64; i++)
+      {
+	auto const t1 = h +
+	  (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) +
+	  ((e & f) ^ (~e & g)) +
+	  s_sha256_k[i] +
+	  w[i];
+	auto const t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) +
+	  ((a & b) ^ (a & c) ^ (b & c));
+
+	h = g;
+	g = f;
+	f = e;
+	e = d + t1;
+	d = c;
+	c = b;
+	b = a;
+	a = t1 + t2;
+      }
+
+    m_h[0] += a;
+    m_h[1] += b;
+    m_h[2] += c;
+    m_h[3] += d;
+    m_h[4] += e;
+    m_h[5] += f;
+    m_h[6] += g;
+    m_h[7] += h;
+    memset(w, 0, sizeof(w));
+  }
+
+  void reset(void)
+  {
+    m_h[0] = 0x6a09e667;
+    m_h[1] = 0xbb67ae85;
+    m_h[2] = 0x3c6ef372;
+    m_h[3] = 0xa54ff53a;
+    m_h[4] = 0x510e527f;
+    m_h[5] = 0x9b05688c;
+    m_h[6] = 0x1f83d9ab;
+    m_h[7] = 0x5be0cd19;
+    m_size = 0;
+    m_used = 0;
+  }
+};
+
+#endif